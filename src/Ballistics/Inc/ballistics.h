@@ -0,0 +1,35 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Pointer ballistics
+//Maps tilt to pointer speed through a transfer curve, so small tilts move slowly for precise positioning
+//and large tilts move quickly for travel
+//Curves are lookup tables, interpolated with shifts only, so every sample costs the same
+#ifndef BALLISTICS_H
+#define BALLISTICS_H
+
+#include <stdint.h>
+
+//Table entries are this many tilt counts apart
+#define BALLISTICS_STEP_SHIFT 7
+#define BALLISTICS_STEP (1 << BALLISTICS_STEP_SHIFT)
+
+//Number of table entries. Tilt beyond the last entry (1g) uses the last entry
+#define BALLISTICS_TABLE_SIZE 17
+
+typedef enum
+{
+	BALLISTICS_LINEAR, //Output = input, as before ballistics were added
+	BALLISTICS_SOFT, //Dead zone, slow linear region for precision, then exponential gain for travel
+	BALLISTICS_STEEP, //Smaller dead zone and stronger gain, for large screens
+	BALLISTICS_NUM_PROFILES
+} ballisticsProfile_t;
+
+#define BALLISTICS_DEFAULT_PROFILE BALLISTICS_SOFT
+
+void ballisticsSetProfile(ballisticsProfile_t profile);
+ballisticsProfile_t ballisticsGetProfile(void);
+int32_t ballisticsApply(int32_t tilt);
+
+#endif
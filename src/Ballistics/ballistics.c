@@ -0,0 +1,61 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+#include <stdint.h>
+#include "ballistics.h"
+
+//Transfer curves, indexed by |tilt| / BALLISTICS_STEP
+//Precomputed from:
+//out = 0 for m <= deadZone
+//out = gain*(m - deadZone) * exp(k*(m - knee)/2048), where the exponential term only applies above the knee
+//SOFT:  deadZone 96, gain 0.5,  knee 512, k 2
+//STEEP: deadZone 64, gain 0.75, knee 384, k 3
+static const int16_t curves[BALLISTICS_NUM_PROFILES][BALLISTICS_TABLE_SIZE] =
+{
+	//LINEAR
+	{0, 128, 256, 384, 512, 640, 768, 896, 1024, 1152, 1280, 1408, 1536, 1664, 1792, 1920, 2048},
+	//SOFT
+	{0, 16, 80, 144, 208, 308, 431, 582, 765, 986, 1253, 1574, 1957, 2415, 2960, 3607, 4374},
+	//STEEP
+	{0, 48, 144, 240, 405, 629, 927, 1321, 1839, 2513, 3388, 4518, 5968, 7825, 10194, 13207, 17029}
+};
+
+//Curve in use. Changed at runtime by ballisticsSetProfile
+//A single pointer, so it can be swapped without a lock
+static const int16_t * volatile curve = curves[BALLISTICS_DEFAULT_PROFILE];
+static volatile ballisticsProfile_t currentProfile = BALLISTICS_DEFAULT_PROFILE;
+
+void ballisticsSetProfile(ballisticsProfile_t profile)
+{
+	if(profile < BALLISTICS_NUM_PROFILES)
+	{
+		curve = curves[profile];
+		currentProfile = profile;
+	}
+}
+
+ballisticsProfile_t ballisticsGetProfile(void)
+{
+	return currentProfile;
+}
+
+//Convert a tilt sample into a pointer velocity, in the same units
+//Linear interpolation between table entries, using shifts instead of division
+int32_t ballisticsApply(int32_t tilt)
+{
+	const int16_t *table = curve;
+	int32_t mag = (tilt < 0 ? -tilt : tilt);
+	int32_t out;
+	
+	uint32_t i = mag >> BALLISTICS_STEP_SHIFT;
+	if(i >= BALLISTICS_TABLE_SIZE-1)
+	{
+		out = table[BALLISTICS_TABLE_SIZE-1];
+	} else {
+		int32_t frac = mag & (BALLISTICS_STEP-1);
+		out = table[i] + (((table[i+1] - table[i]) * frac) >> BALLISTICS_STEP_SHIFT);
+	}
+	
+	return (tilt < 0 ? -out : out);
+}
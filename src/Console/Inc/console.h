@@ -0,0 +1,25 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Command console on the debug UART
+//Lines typed at the terminal are run as commands, to read and change tuning without reflashing. Type help for the list
+//Characters are received by the UART interrupt, which wakes the console task
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+//Longest command line, including the terminator
+#define CONSOLE_LINE_SIZE 48
+
+//Most words in a command line, including the command
+#define CONSOLE_MAX_ARGS 6
+
+//Set by main when the task is created
+extern TaskHandle_t consoleTaskHandle;
+
+void consoleTask(void *pvParameters);
+
+#endif
@@ -0,0 +1,24 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Pipeline tuning that can be changed from the console, as PARAM(id, name, default, min, max, help)
+//The defaults are the values that were fixed in rtos_tasks.c before the console existed
+//Saved parameters are keyed by position (KV_KEY_PARAM_BASE + id), so only add to the end
+
+//No include guard, as it is included once for each use of PARAM
+
+//Touch strip (touch task)
+PARAM(PARAM_TOUCH_MS, "touch_ms", 2, 1, 50, "Touch sample period, ms")
+PARAM(PARAM_TOUCH_MIN, "touch_min", 150, 0, 65535, "Lowest count taken as a touch")
+PARAM(PARAM_TOUCH_MAX, "touch_max", 1500, 0, 65535, "Highest count taken as a touch")
+PARAM(PARAM_TOUCH_STEP, "touch_step", 50, 1, 65535, "Biggest change between samples taken as movement")
+PARAM(PARAM_TOUCH_SETTLE, "touch_settle", 100, 0, 255, "Samples touched before movement counts")
+PARAM(PARAM_TOUCH_SCALE, "touch_scale", 16, 1, 1024, "Strip counts per scroll step")
+
+//Accelerometer (accel task)
+PARAM(PARAM_ACCEL_MS, "accel_ms", 2, 1, 50, "Accelerometer sample period, ms")
+PARAM(PARAM_ABS_GAIN, "abs_gain", 16, 1, 256, "Screen units per count of tilt in absolute mode")
+
+//Reports (gather task)
+PARAM(PARAM_REPORT_MS, "report_ms", 10, 1, 100, "Report period, ms")
@@ -0,0 +1,51 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Runtime tunable parameters, listed in param_table.h
+//Each parameter is one aligned 32 bit word, so it is read and written in a single access
+//Tasks read them with paramGet every time they need them, with no lock. A change is seen on the next read
+//Only the console writes them, and it checks the limits first
+//They can be saved to flash with the ballistics curve and gesture tuning, and are loaded at boot
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum
+{
+#define PARAM(id, name, def, min, max, help) id,
+#include "param_table.h"
+#undef PARAM
+	PARAM_COUNT
+} paramId_t;
+
+extern volatile int32_t paramValues[PARAM_COUNT];
+
+//Current value of a parameter
+#define paramGet(id) (paramValues[(id)])
+
+//Find a parameter by name. Returns PARAM_COUNT if there isn't one
+paramId_t paramFind(const char *name);
+
+//Set a parameter. Returns false, and leaves it alone, if value is outside its limits
+//or would put touch_min at or above touch_max
+bool paramSet(paramId_t id, int32_t value);
+
+//Load everything saved in flash. Anything not saved, or out of its limits, keeps its default
+//If the saved touch_min and touch_max are the wrong way round, both keep their defaults
+//Call after kvstoreInit and before the scheduler starts
+void paramsLoad(void);
+
+//Save every parameter, the ballistics curve and the gesture tuning to flash. Only changes are written
+//Returns false if the flash couldn't be written
+bool paramsSave(void);
+
+//Name, limits and description, for the console
+const char *paramName(paramId_t id);
+const char *paramHelp(paramId_t id);
+int32_t paramMin(paramId_t id);
+int32_t paramMax(paramId_t id);
+
+#endif
@@ -0,0 +1,347 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "uart.h"
+#include "params.h"
+#include "ballistics.h"
+#include "gesture.h"
+#include "trace.h"
+#include "telemetry.h"
+#include "kvstore.h"
+#include "touch.h"
+#include "console.h"
+
+TaskHandle_t consoleTaskHandle = NULL;
+
+typedef struct
+{
+	const char *name;
+	void (*run)(int argc, char **argv);
+	const char *help;
+} consoleCommand_t;
+
+static void commandHelp(int argc, char **argv);
+static void commandGet(int argc, char **argv);
+static void commandSet(int argc, char **argv);
+static void commandCurve(int argc, char **argv);
+static void commandFlick(int argc, char **argv);
+static void commandTrace(int argc, char **argv);
+static void commandTelemetry(int argc, char **argv);
+static void commandSave(int argc, char **argv);
+static void commandForget(int argc, char **argv);
+static void commandCalibrate(int argc, char **argv);
+
+static const consoleCommand_t commands[] = {
+	{"help", commandHelp, "List commands"},
+	{"get", commandGet, "get [name]: Show one parameter, or all of them"},
+	{"set", commandSet, "set name value: Change a parameter"},
+	{"curve", commandCurve, "curve [n]: Show or set the ballistics curve. 0 linear, 1 soft, 2 steep"},
+	{"flick", commandFlick, "flick [enabled on off max_ms gap_ms]: Show or set flick gesture tuning"},
+	{"trace", commandTrace, "Dump the event trace"},
+	{"telemetry", commandTelemetry, "telemetry on|off: Start or stop the sensor stream"},
+	{"save", commandSave, "Save parameters, curve and flick tuning to flash"},
+	{"forget", commandForget, "Erase everything saved in flash. Defaults are used from the next reset"},
+	{"calibrate", commandCalibrate, "Calibrate the touch strip and save it. Don't touch the strip"}
+};
+
+#define CONSOLE_NUM_COMMANDS (sizeof(commands)/sizeof(commands[0]))
+
+//Send a signed number in decimal
+static void consolePutInt(int32_t val)
+{
+	if(val < 0)
+	{
+		uart_putchar('-');
+		val = -val;
+	}
+	uart_putdec((uint32_t)val);
+}
+
+//Read a whole word as a number. Returns false if it isn't one
+static bool consoleParseInt(const char *str, int32_t *val)
+{
+	char *end;
+	long result = strtol(str, &end, 0);
+	
+	if(end == str || *end != '\0')
+	{
+		return false;
+	}
+	*val = (int32_t)result;
+	return true;
+}
+
+static void commandHelp(int argc, char **argv)
+{
+	for(int i=0; i<CONSOLE_NUM_COMMANDS; i++)
+	{
+		uart_puts(commands[i].name);
+		uart_puts(" - ");
+		uart_puts(commands[i].help);
+		uart_puts("\r\n");
+		uart_flush();
+	}
+}
+
+//name = value (min to max) help
+static void consolePrintParam(paramId_t id)
+{
+	uart_puts(paramName(id));
+	uart_puts(" = ");
+	consolePutInt(paramGet(id));
+	uart_puts(" (");
+	consolePutInt(paramMin(id));
+	uart_puts(" to ");
+	consolePutInt(paramMax(id));
+	uart_puts(") ");
+	uart_puts(paramHelp(id));
+	uart_puts("\r\n");
+	uart_flush();
+}
+
+static void commandGet(int argc, char **argv)
+{
+	if(argc < 2)
+	{
+		for(int i=0; i<PARAM_COUNT; i++)
+		{
+			consolePrintParam((paramId_t)i);
+		}
+		return;
+	}
+	
+	paramId_t id = paramFind(argv[1]);
+	if(id == PARAM_COUNT)
+	{
+		uart_puts("No such parameter\r\n");
+		return;
+	}
+	consolePrintParam(id);
+}
+
+static void commandSet(int argc, char **argv)
+{
+	int32_t value;
+	paramId_t id;
+	
+	if(argc != 3 || !consoleParseInt(argv[2], &value))
+	{
+		uart_puts("Usage: set name value\r\n");
+		return;
+	}
+	
+	id = paramFind(argv[1]);
+	if(id == PARAM_COUNT)
+	{
+		uart_puts("No such parameter\r\n");
+		return;
+	}
+	if(!paramSet(id, value))
+	{
+		uart_puts((id == PARAM_TOUCH_MIN || id == PARAM_TOUCH_MAX) ? "Out of range, or touch_min not below touch_max\r\n" : "Out of range\r\n");
+		return;
+	}
+	consolePrintParam(id);
+}
+
+static void commandCurve(int argc, char **argv)
+{
+	int32_t value;
+	
+	if(argc >= 2)
+	{
+		if(!consoleParseInt(argv[1], &value) || value < 0 || value >= BALLISTICS_NUM_PROFILES)
+		{
+			uart_puts("No such curve\r\n");
+			return;
+		}
+		ballisticsSetProfile((ballisticsProfile_t)value);
+	}
+	
+	uart_puts("curve ");
+	uart_putdec(ballisticsGetProfile());
+	uart_puts("\r\n");
+}
+
+static void commandFlick(int argc, char **argv)
+{
+	gestureConfig_t config;
+	int32_t values[5];
+	
+	if(argc >= 2)
+	{
+		if(argc != 6)
+		{
+			uart_puts("Usage: flick enabled on off max_ms gap_ms\r\n");
+			return;
+		}
+		for(int i=0; i<5; i++)
+		{
+			if(!consoleParseInt(argv[i+1], &values[i]) || values[i] < 0 || values[i] > INT16_MAX)
+			{
+				uart_puts("Out of range\r\n");
+				return;
+			}
+		}
+		//A flick ends when the tilt falls back below off, so off must be below on or there is no hysteresis
+		if(values[2] >= values[1])
+		{
+			uart_puts("off not below on\r\n");
+			return;
+		}
+		config.enabled = (values[0] != 0);
+		config.onThreshold = (int16_t)values[1];
+		config.offThreshold = (int16_t)values[2];
+		config.maxFlickMs = (uint16_t)values[3];
+		config.refractoryMs = (uint16_t)values[4];
+		gestureSetConfig(&config);
+	}
+	
+	gestureGetConfig(&config);
+	uart_puts("flick ");
+	uart_putdec(config.enabled ? 1 : 0);
+	uart_puts(" ");
+	consolePutInt(config.onThreshold);
+	uart_puts(" ");
+	consolePutInt(config.offThreshold);
+	uart_puts(" ");
+	uart_putdec(config.maxFlickMs);
+	uart_puts(" ");
+	uart_putdec(config.refractoryMs);
+	uart_puts("\r\n");
+}
+
+static void commandTrace(int argc, char **argv)
+{
+	traceDump();
+}
+
+static void commandTelemetry(int argc, char **argv)
+{
+	if(argc == 2 && strcmp(argv[1], "on") == 0)
+	{
+		telemetrySetEnabled(true);
+	} else if(argc == 2 && strcmp(argv[1], "off") == 0) {
+		telemetrySetEnabled(false);
+	} else {
+		uart_puts("Usage: telemetry on|off\r\n");
+	}
+}
+
+//Report the result of a flash write
+static void consoleFlashResult(bool ok)
+{
+	if(ok)
+	{
+		uart_puts("Saved. ");
+		uart_putdec(kvstoreFree());
+		uart_puts(" writes before the next erase\r\n");
+	} else {
+		uart_puts("Flash write failed\r\n");
+	}
+}
+
+static void commandSave(int argc, char **argv)
+{
+	consoleFlashResult(paramsSave());
+}
+
+static void commandForget(int argc, char **argv)
+{
+	consoleFlashResult(kvstoreErase());
+}
+
+static void commandCalibrate(int argc, char **argv)
+{
+	consoleFlashResult(touch_calibrate());
+}
+
+//Split a line into words, in place, and run it
+static void consoleRun(char *line)
+{
+	char *argv[CONSOLE_MAX_ARGS];
+	int argc = 0;
+	char *p = line;
+	
+	//Every space is cleared, including any after the last word, so each word ends where it should
+	while(*p)
+	{
+		while(*p == ' ')
+		{
+			*p++ = '\0';
+		}
+		if(*p)
+		{
+			if(argc == CONSOLE_MAX_ARGS)
+			{
+				uart_puts("Too many words\r\n");
+				return;
+			}
+			argv[argc++] = p;
+			while(*p && *p != ' ')
+			{
+				p++;
+			}
+		}
+	}
+	
+	if(argc == 0)
+	{
+		return;
+	}
+	
+	for(int i=0; i<CONSOLE_NUM_COMMANDS; i++)
+	{
+		if(strcmp(argv[0], commands[i].name) == 0)
+		{
+			commands[i].run(argc, argv);
+			return;
+		}
+	}
+	uart_puts("Unknown command. Try help\r\n");
+}
+
+//Collect a line, echoing it back, then run it
+void consoleTask(void *pvParameters)
+{
+	char line[CONSOLE_LINE_SIZE];
+	uint8_t len = 0;
+	
+	uart_rx_notify(consoleTaskHandle);
+	
+	while(1)
+	{
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		
+		int c;
+		while((c = uart_getchar()) >= 0)
+		{
+			if(c == '\r' || c == '\n')
+			{
+				if(len > 0)
+				{
+					uart_puts("\r\n");
+					line[len] = '\0';
+					consoleRun(line);
+					len = 0;
+				}
+			} else if(c == '\b' || c == 0x7F) {
+				if(len > 0)
+				{
+					len--;
+					uart_puts("\b \b");
+				}
+			} else if(c >= ' ' && len < CONSOLE_LINE_SIZE-1) {
+				line[len++] = (char)c;
+				uart_putchar((char)c);
+			}
+		}
+	}
+}
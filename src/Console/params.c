@@ -0,0 +1,161 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "kvstore.h"
+#include "ballistics.h"
+#include "gesture.h"
+#include "params.h"
+
+volatile int32_t paramValues[PARAM_COUNT] = {
+#define PARAM(id, name, def, min, max, help) def,
+#include "param_table.h"
+#undef PARAM
+};
+
+static const struct
+{
+	const char *name;
+	const char *help;
+	int32_t min;
+	int32_t max;
+} paramInfo[PARAM_COUNT] = {
+#define PARAM(id, name, def, min, max, help) {name, help, min, max},
+#include "param_table.h"
+#undef PARAM
+};
+
+static bool paramInRange(paramId_t id, int32_t value)
+{
+	return value >= paramInfo[id].min && value <= paramInfo[id].max;
+}
+
+//Limits between parameters, on top of each one's own
+//A touch is a count between touch_min and touch_max, so with them the wrong way round the strip would never see one
+static bool paramsConsistent(const int32_t *values)
+{
+	return values[PARAM_TOUCH_MIN] < values[PARAM_TOUCH_MAX];
+}
+
+paramId_t paramFind(const char *name)
+{
+	for(int i=0; i<PARAM_COUNT; i++)
+	{
+		if(strcmp(name, paramInfo[i].name) == 0)
+		{
+			return (paramId_t)i;
+		}
+	}
+	return PARAM_COUNT;
+}
+
+bool paramSet(paramId_t id, int32_t value)
+{
+	int32_t values[PARAM_COUNT];
+	
+	if(id >= PARAM_COUNT || !paramInRange(id, value))
+	{
+		return false;
+	}
+	
+	for(int i=0; i<PARAM_COUNT; i++)
+	{
+		values[i] = paramValues[i];
+	}
+	values[id] = value;
+	if(!paramsConsistent(values))
+	{
+		return false;
+	}
+	
+	paramValues[id] = value;
+	return true;
+}
+
+void paramsLoad(void)
+{
+	int32_t value, times;
+	int32_t loaded[PARAM_COUNT];
+	gestureConfig_t config;
+	
+	//Load them all before checking the limits between them, as a saved pair may only be valid together
+	for(int i=0; i<PARAM_COUNT; i++)
+	{
+		loaded[i] = paramValues[i];
+		if(kvstoreGet(KV_KEY_PARAM_BASE + i, &value) && paramInRange((paramId_t)i, value))
+		{
+			loaded[i] = value;
+		}
+	}
+	if(!paramsConsistent(loaded))
+	{
+		loaded[PARAM_TOUCH_MIN] = paramValues[PARAM_TOUCH_MIN];
+		loaded[PARAM_TOUCH_MAX] = paramValues[PARAM_TOUCH_MAX];
+	}
+	for(int i=0; i<PARAM_COUNT; i++)
+	{
+		paramValues[i] = loaded[i];
+	}
+	
+	if(kvstoreGet(KV_KEY_CURVE, &value))
+	{
+		ballisticsSetProfile((ballisticsProfile_t)value);
+	}
+	
+	gestureGetConfig(&config);
+	if(kvstoreGet(KV_KEY_FLICK_ENABLED, &value))
+	{
+		config.enabled = (value != 0);
+	}
+	//Thresholds saved before off had to be below on are left at the defaults
+	if(kvstoreGet(KV_KEY_FLICK_THRESHOLDS, &value) && kvstoreGet(KV_KEY_FLICK_TIMES, &times) && (int16_t)(value >> 16) < (int16_t)value)
+	{
+		config.onThreshold = (int16_t)value;
+		config.offThreshold = (int16_t)(value >> 16);
+		config.maxFlickMs = (uint16_t)times;
+		config.refractoryMs = (uint16_t)((uint32_t)times >> 16);
+	}
+	gestureSetConfig(&config);
+}
+
+bool paramsSave(void)
+{
+	bool ok = true;
+	gestureConfig_t config;
+	
+	for(int i=0; i<PARAM_COUNT; i++)
+	{
+		ok = kvstoreSet(KV_KEY_PARAM_BASE + i, paramGet((paramId_t)i)) && ok;
+	}
+	
+	ok = kvstoreSet(KV_KEY_CURVE, ballisticsGetProfile()) && ok;
+	
+	gestureGetConfig(&config);
+	ok = kvstoreSet(KV_KEY_FLICK_ENABLED, config.enabled ? 1 : 0) && ok;
+	ok = kvstoreSet(KV_KEY_FLICK_THRESHOLDS, (uint16_t)config.onThreshold | ((uint32_t)(uint16_t)config.offThreshold << 16)) && ok;
+	ok = kvstoreSet(KV_KEY_FLICK_TIMES, config.maxFlickMs | ((uint32_t)config.refractoryMs << 16)) && ok;
+	return ok;
+}
+
+const char *paramName(paramId_t id)
+{
+	return paramInfo[id].name;
+}
+
+const char *paramHelp(paramId_t id)
+{
+	return paramInfo[id].help;
+}
+
+int32_t paramMin(paramId_t id)
+{
+	return paramInfo[id].min;
+}
+
+int32_t paramMax(paramId_t id)
+{
+	return paramInfo[id].max;
+}
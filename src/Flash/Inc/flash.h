@@ -0,0 +1,29 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Program flash driver for the FTFA controller
+//Erase and program run with interrupts off, as nothing can be read from flash while a command runs
+//A sector erase can take up to ~100ms, so only use this from boot or from a low priority task
+//Only uses standard headers, so the key/value store can be built on the host against a simulated flash (tools/kvstore_sim.c)
+#ifndef FLASH_H
+#define FLASH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//Smallest block that can be erased, in bytes
+#define FLASH_SECTOR_SIZE 1024
+
+//Erase the sector at address (which must be sector aligned) to all 1s
+//Returns false if the controller reports an error
+bool flashEraseSector(uint32_t address);
+
+//Program one aligned word. Programming can only clear bits, so the word should be erased first
+//Returns false if the controller reports an error
+bool flashProgramWord(uint32_t address, uint32_t data);
+
+//Read one aligned word
+uint32_t flashReadWord(uint32_t address);
+
+#endif
@@ -0,0 +1,48 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Key/value store in the last two sectors of flash, for settings that should survive a reset
+//Writes are appended to a log in the active sector, so a key can be changed many times between erases
+//When the sector is full, the newest value of every key is copied into the other sector, which then becomes active
+//The sectors take turns, so erases are spread over both, and each is erased once per ~120 writes
+//A sector only becomes active once its header is written, after the copy, so a reset part way through loses nothing
+//Records carry a check value, so one cut short by a reset is ignored
+//The linker is told to keep code out of these sectors (IROM1 size in the project)
+#ifndef KVSTORE_H
+#define KVSTORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//First of the two sectors
+#ifndef KVSTORE_BASE
+#define KVSTORE_BASE 0x3F800
+#endif
+
+//Keys. Never reuse a number for something else, as old values may still be in flash
+#define KV_KEY_TOUCH_CAL		0x0001 //Touch strip reading with nothing touching it
+#define KV_KEY_CURVE			0x0002 //Ballistics curve
+#define KV_KEY_FLICK_ENABLED	0x0003 //Flick gestures on or off
+#define KV_KEY_FLICK_THRESHOLDS	0x0004 //Flick on threshold, and off threshold << 16
+#define KV_KEY_FLICK_TIMES		0x0005 //Flick max time, and gap time << 16
+#define KV_KEY_PARAM_BASE		0x0100 //Add the paramId_t
+
+//Find the active sector, or set the store up empty if there isn't one
+//Returns false if the flash couldn't be written
+bool kvstoreInit(void);
+
+//Newest value of key. Returns false if it has never been set
+bool kvstoreGet(uint16_t key, int32_t *value);
+
+//Set key. Nothing is written if it already has this value
+//Returns false if the flash couldn't be written, or there are too many keys to fit in a sector
+bool kvstoreSet(uint16_t key, int32_t value);
+
+//Forget every key
+bool kvstoreErase(void);
+
+//Number of records that can be written before the next erase, for information
+uint32_t kvstoreFree(void);
+
+#endif
@@ -0,0 +1,77 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <MKL46Z4.H>
+#include "flash.h"
+
+//FTFA commands (reference manual, FTFA chapter)
+#define FLASH_CMD_PROGRAM_LONGWORD 0x06
+#define FLASH_CMD_ERASE_SECTOR 0x09
+
+#define FLASH_ERROR_MASK (FTFA_FSTAT_RDCOLERR_MASK | FTFA_FSTAT_ACCERR_MASK | FTFA_FSTAT_FPVIOL_MASK)
+
+//Starts the loaded command and waits for it to finish. Takes the address of FSTAT
+//The flash can't be read while it runs, so this has to run from RAM. Initialised data is copied to RAM at startup
+//  movs r1, #0x80      ;CCIF
+//  strb r1, [r0]       ;Writing 1 to CCIF launches the command
+//wait:
+//  ldrb r2, [r0]
+//  tst r2, r1
+//  beq wait            ;CCIF is set again when the command is done
+//  bx lr
+static uint32_t flashRunCode[3] = {0x70012180, 0x420A7802, 0x4770D0FC};
+
+//Launch the command in FCCOB and wait for it
+static bool flashCommand(void)
+{
+	//Set bit 0 of the address to call Thumb code
+	void (*run)(volatile uint8_t *fstat) = (void (*)(volatile uint8_t *))((uint32_t)flashRunCode | 1);
+	
+	//Interrupt handlers and their vectors are in flash too
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	run(&FTFA->FSTAT);
+	//The flash controller caches reads, and doesn't see the array change under it
+	//Clear the cache so what was just written is read back, rather than what was there before
+	MCM->PLACR |= MCM_PLACR_CFCC_MASK;
+	__set_PRIMASK(primask);
+	
+	return !(FTFA->FSTAT & (FLASH_ERROR_MASK | FTFA_FSTAT_MGSTAT0_MASK));
+}
+
+//Wait for any command in progress, clear old errors (write 1 to clear), and load the command and address
+static void flashLoad(uint8_t command, uint32_t address)
+{
+	while(!(FTFA->FSTAT & FTFA_FSTAT_CCIF_MASK));
+	FTFA->FSTAT = FLASH_ERROR_MASK;
+	
+	FTFA->FCCOB0 = command;
+	FTFA->FCCOB1 = (uint8_t)(address >> 16);
+	FTFA->FCCOB2 = (uint8_t)(address >> 8);
+	FTFA->FCCOB3 = (uint8_t)address;
+}
+
+bool flashEraseSector(uint32_t address)
+{
+	flashLoad(FLASH_CMD_ERASE_SECTOR, address);
+	return flashCommand();
+}
+
+bool flashProgramWord(uint32_t address, uint32_t data)
+{
+	flashLoad(FLASH_CMD_PROGRAM_LONGWORD, address);
+	//FCCOB4 is the byte at the highest address
+	FTFA->FCCOB4 = (uint8_t)(data >> 24);
+	FTFA->FCCOB5 = (uint8_t)(data >> 16);
+	FTFA->FCCOB6 = (uint8_t)(data >> 8);
+	FTFA->FCCOB7 = (uint8_t)data;
+	return flashCommand();
+}
+
+uint32_t flashReadWord(uint32_t address)
+{
+	return *(const volatile uint32_t *)address;
+}
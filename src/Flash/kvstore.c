@@ -0,0 +1,236 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Sector layout, in words:
+//  0: KVSTORE_MAGIC, 1: generation. Written after everything else, so an unfinished copy is never used
+//  then records of two words: key | check << 16, then the value
+//Erased flash is all 1s, so an unwritten record has key 0xFFFF
+//The value is written before the key, so a record cut short by a reset never has a valid check
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "flash.h"
+#include "kvstore.h"
+
+#define KVSTORE_MAGIC 0x4B565331 //"KVS1"
+#define KVSTORE_ERASED 0xFFFFFFFF
+#define KVSTORE_EMPTY_KEY 0xFFFF
+
+#define KVSTORE_HEADER_SIZE 8
+#define KVSTORE_RECORD_SIZE 8
+#define KVSTORE_RECORDS ((FLASH_SECTOR_SIZE - KVSTORE_HEADER_SIZE) / KVSTORE_RECORD_SIZE)
+
+//Active sector, its generation, and the next record to write in it
+static uint32_t activeSector = 0;
+static uint32_t generation = 0;
+static uint32_t nextRecord = 0;
+
+static uint32_t kvstoreSectorAddress(uint32_t sector)
+{
+	return KVSTORE_BASE + sector*FLASH_SECTOR_SIZE;
+}
+
+static uint32_t kvstoreRecordAddress(uint32_t sector, uint32_t record)
+{
+	return kvstoreSectorAddress(sector) + KVSTORE_HEADER_SIZE + record*KVSTORE_RECORD_SIZE;
+}
+
+static uint16_t kvstoreCheck(uint16_t key, int32_t value)
+{
+	return (uint16_t)~(key ^ (uint32_t)value ^ ((uint32_t)value >> 16) ^ 0x5A5A);
+}
+
+//Read a record. Returns false if it is unwritten or damaged
+static bool kvstoreRead(uint32_t sector, uint32_t record, uint16_t *key, int32_t *value)
+{
+	uint32_t address = kvstoreRecordAddress(sector, record);
+	uint32_t keyWord = flashReadWord(address);
+	
+	*key = (uint16_t)keyWord;
+	*value = (int32_t)flashReadWord(address + 4);
+	return (*key != KVSTORE_EMPTY_KEY && (uint16_t)(keyWord >> 16) == kvstoreCheck(*key, *value));
+}
+
+static bool kvstoreWrite(uint32_t sector, uint32_t record, uint16_t key, int32_t value)
+{
+	uint32_t address = kvstoreRecordAddress(sector, record);
+	
+	return flashProgramWord(address + 4, (uint32_t)value)
+		&& flashProgramWord(address, key | ((uint32_t)kvstoreCheck(key, value) << 16));
+}
+
+//True if the sector has a finished header. Its generation is returned
+static bool kvstoreValid(uint32_t sector, uint32_t *gen)
+{
+	*gen = flashReadWord(kvstoreSectorAddress(sector) + 4);
+	return flashReadWord(kvstoreSectorAddress(sector)) == KVSTORE_MAGIC && *gen != KVSTORE_ERASED;
+}
+
+//Erase a sector and write its header
+static bool kvstoreFormat(uint32_t sector, uint32_t gen)
+{
+	uint32_t address = kvstoreSectorAddress(sector);
+	
+	return flashEraseSector(address)
+		&& flashProgramWord(address + 4, gen)
+		&& flashProgramWord(address, KVSTORE_MAGIC);
+}
+
+//The next record to write is after the last one that has anything in it, even a damaged one
+static uint32_t kvstoreFindEnd(uint32_t sector)
+{
+	uint32_t end = KVSTORE_RECORDS;
+	
+	while(end > 0)
+	{
+		uint32_t address = kvstoreRecordAddress(sector, end-1);
+		if(flashReadWord(address) != KVSTORE_ERASED || flashReadWord(address + 4) != KVSTORE_ERASED)
+		{
+			break;
+		}
+		end--;
+	}
+	return end;
+}
+
+bool kvstoreInit(void)
+{
+	uint32_t gen[2];
+	bool valid[2];
+	
+	for(uint32_t i=0; i<2; i++)
+	{
+		valid[i] = kvstoreValid(i, &gen[i]);
+	}
+	
+	if(!valid[0] && !valid[1])
+	{
+		activeSector = 0;
+		generation = 1;
+		nextRecord = 0;
+		return kvstoreFormat(activeSector, generation);
+	}
+	
+	//If both are finished, the newer one is active. The other is left over from before the last copy
+	activeSector = (valid[1] && (!valid[0] || gen[1] > gen[0])) ? 1 : 0;
+	generation = gen[activeSector];
+	nextRecord = kvstoreFindEnd(activeSector);
+	return true;
+}
+
+bool kvstoreGet(uint16_t key, int32_t *value)
+{
+	bool found = false;
+	
+	//Newest last, so keep going to the end
+	for(uint32_t i=0; i<nextRecord; i++)
+	{
+		uint16_t recordKey;
+		int32_t recordValue;
+		if(kvstoreRead(activeSector, i, &recordKey, &recordValue) && recordKey == key)
+		{
+			*value = recordValue;
+			found = true;
+		}
+	}
+	return found;
+}
+
+//Copy the newest value of every key, apart from skipKey, into the other sector, and make it active
+static bool kvstoreCompact(uint16_t skipKey)
+{
+	uint32_t from = activeSector;
+	uint32_t to = activeSector ^ 1;
+	uint32_t count = 0;
+	
+	//Erase, but don't write the header until the copy is done
+	if(!flashEraseSector(kvstoreSectorAddress(to)))
+	{
+		return false;
+	}
+	
+	for(uint32_t i=0; i<nextRecord; i++)
+	{
+		uint16_t key, laterKey;
+		int32_t value, laterValue;
+		if(!kvstoreRead(from, i, &key, &value) || key == skipKey)
+		{
+			continue;
+		}
+		
+		//Only the newest record of each key is copied
+		bool newest = true;
+		for(uint32_t j=i+1; j<nextRecord && newest; j++)
+		{
+			if(kvstoreRead(from, j, &laterKey, &laterValue) && laterKey == key)
+			{
+				newest = false;
+			}
+		}
+		
+		if(newest)
+		{
+			//Leave room for the record being set
+			if(count >= KVSTORE_RECORDS-1 || !kvstoreWrite(to, count, key, value))
+			{
+				return false;
+			}
+			count++;
+		}
+	}
+	
+	if(!flashProgramWord(kvstoreSectorAddress(to) + 4, generation + 1)
+		|| !flashProgramWord(kvstoreSectorAddress(to), KVSTORE_MAGIC))
+	{
+		return false;
+	}
+	
+	activeSector = to;
+	generation++;
+	nextRecord = count;
+	return true;
+}
+
+bool kvstoreSet(uint16_t key, int32_t value)
+{
+	int32_t current;
+	
+	if(key == KVSTORE_EMPTY_KEY)
+	{
+		return false;
+	}
+	if(kvstoreGet(key, &current) && current == value)
+	{
+		return true;
+	}
+	
+	if(nextRecord >= KVSTORE_RECORDS && !kvstoreCompact(key))
+	{
+		return false;
+	}
+	
+	//Even if this fails part way, the space is used
+	nextRecord++;
+	return kvstoreWrite(activeSector, nextRecord-1, key, value);
+}
+
+bool kvstoreErase(void)
+{
+	//A new generation in the other sector, so the old one is ignored even if it can't be erased
+	uint32_t to = activeSector ^ 1;
+	
+	if(!kvstoreFormat(to, generation + 1))
+	{
+		return false;
+	}
+	activeSector = to;
+	generation++;
+	nextRecord = 0;
+	return true;
+}
+
+uint32_t kvstoreFree(void)
+{
+	return KVSTORE_RECORDS - nextRecord;
+}
@@ -0,0 +1,32 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Binary packets in the debug UART output, shared by log messages and telemetry
+//A packet is a type byte, the payload, then a CRC-16/CCITT of both. Little endian
+//It is COBS encoded and has a 0 byte before and after. COBS removes every 0 from the packet and text never has one,
+//so packets can be picked out of the text around them, and whatever bytes the payload holds
+//tools/log_decode.py and tools/telemetry_capture.py decode them
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//Largest payload
+#define FRAME_MAX_PAYLOAD 40
+
+//Packet types. Numbers are part of the stream format, so only add to the end
+typedef enum
+{
+	FRAME_TELEMETRY_TOUCH = 1,
+	FRAME_TELEMETRY_ACCEL = 2,
+	FRAME_LOG = 3
+} frameType_t;
+
+//Send one packet. len is clamped to FRAME_MAX_PAYLOAD
+//Safe from tasks and interrupts. It is one UART write, so it is sent whole or dropped (and counted in uartDropped)
+//Returns false if it was dropped
+bool frameSend(frameType_t type, const uint8_t *payload, uint8_t len);
+
+#endif
@@ -0,0 +1,78 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "uart.h"
+#include "frame.h"
+
+//Type, payload, CRC
+#define FRAME_PACKET_SIZE (1 + FRAME_MAX_PAYLOAD + 2)
+
+//COBS adds one byte per 254, plus the delimiters
+#define FRAME_ENCODED_SIZE (FRAME_PACKET_SIZE + 1 + 2)
+
+//CRC-16/CCITT (polynomial 0x1021, start 0xFFFF), a nibble at a time to keep the table small
+static uint16_t frameCrc(const uint8_t *data, uint8_t len)
+{
+	static const uint16_t table[16] = {
+		0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+		0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+	};
+	uint16_t crc = 0xFFFF;
+	
+	while(len--)
+	{
+		crc = (crc << 4) ^ table[(crc >> 12) ^ (*data >> 4)];
+		crc = (crc << 4) ^ table[(crc >> 12) ^ (*data & 0xF)];
+		data++;
+	}
+	return crc;
+}
+
+//COBS encode len bytes of in to out. Returns the encoded length
+//Every 0 is replaced by the distance to the next one, so the encoded data has no zeros
+static uint8_t frameCobs(const uint8_t *in, uint8_t len, uint8_t *out)
+{
+	uint8_t *code = out; //Where the current distance goes
+	uint8_t *p = out + 1;
+	
+	for(uint8_t i=0; i<len; i++)
+	{
+		if(in[i] == 0)
+		{
+			*code = p - code;
+			code = p++;
+		} else {
+			*p++ = in[i];
+		}
+	}
+	*code = p - code;
+	return p - out;
+}
+
+bool frameSend(frameType_t type, const uint8_t *payload, uint8_t len)
+{
+	uint8_t packet[FRAME_PACKET_SIZE];
+	uint8_t encoded[FRAME_ENCODED_SIZE];
+	
+	if(len > FRAME_MAX_PAYLOAD)
+	{
+		len = FRAME_MAX_PAYLOAD;
+	}
+	
+	packet[0] = (uint8_t)type;
+	memcpy(&packet[1], payload, len);
+	uint16_t crc = frameCrc(packet, len + 1);
+	packet[len + 1] = (uint8_t)crc;
+	packet[len + 2] = (uint8_t)(crc >> 8);
+	
+	encoded[0] = 0;
+	uint8_t encodedLen = frameCobs(packet, len + 3, &encoded[1]);
+	encoded[encodedLen + 1] = 0;
+	
+	//One write, so packets from different callers never interleave
+	return uart_write(encoded, encodedLen + 2);
+}
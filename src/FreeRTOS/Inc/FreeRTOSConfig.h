@@ -86,17 +86,23 @@
 #include <stdint.h>
 
 #include "debug.h"
+#include "trace.h" //For the trace hooks at the end
 
 extern uint32_t SystemCoreClock;
+extern void statsTimerInit(void); //Run-time stats clock, in stats.c
+extern uint32_t statsTimerRead(void);
 
 #define configUSE_PREEMPTION			1
-#define configUSE_IDLE_HOOK				0
+#define configUSE_IDLE_HOOK				1 //WFI between ticks. See rtos_tasks.c
 #define configUSE_TICK_HOOK				0
+#define configUSE_TICKLESS_IDLE			1 //Long idle periods are timed by the LPTMR. See port.c
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP	20 //Well above the 2ms sample period, so sampling never stops SysTick
 #define configCPU_CLOCK_HZ				( SystemCoreClock )
 #define configTICK_RATE_HZ				( ( TickType_t ) 1000 )
-#define configMAX_PRIORITIES			( 5 )
+#define configMAX_PRIORITIES			( 6 ) //Top priority is reserved for usb_task
 #define configMINIMAL_STACK_SIZE		( ( unsigned short ) 60 )
-#define configTOTAL_HEAP_SIZE			( ( size_t ) ( 6500 ) )
+#define configSUPPORT_STATIC_ALLOCATION	1 //All kernel objects are allocated statically. See main.c
+#define configSUPPORT_DYNAMIC_ALLOCATION	0 //No heap
 #define configMAX_TASK_NAME_LEN			( 5 )
 #define configUSE_TRACE_FACILITY		1
 #define configUSE_16_BIT_TICKS			0
@@ -105,10 +111,12 @@ extern uint32_t SystemCoreClock;
 #define configQUEUE_REGISTRY_SIZE		8
 #define configCHECK_FOR_STACK_OVERFLOW	2
 #define configUSE_RECURSIVE_MUTEXES		1
-#define configUSE_MALLOC_FAILED_HOOK	1
+#define configUSE_MALLOC_FAILED_HOOK	0
 #define configUSE_APPLICATION_TASK_TAG	0
 #define configUSE_COUNTING_SEMAPHORES	1
-#define configGENERATE_RUN_TIME_STATS	0
+#define configGENERATE_RUN_TIME_STATS	1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()	do { statsTimerInit(); traceStart(); } while(0) //Tracing needs the stats clock
+#define portGET_RUN_TIME_COUNTER_VALUE()			statsTimerRead()
 
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES 			0
@@ -116,7 +124,7 @@ extern uint32_t SystemCoreClock;
 
 /* Software timer definitions. */
 #define configUSE_TIMERS				1
-#define configTIMER_TASK_PRIORITY		( 2 )
+#define configTIMER_TASK_PRIORITY		( configMAX_PRIORITIES - 2 ) //With gather, above the sensor tasks, so button debounce isn't held up by sampling
 #define configTIMER_QUEUE_LENGTH		5
 #define configTIMER_TASK_STACK_DEPTH	( 80 )
 
@@ -136,16 +144,40 @@ to exclude the API function. */
 #define INCLUDE_vTaskSuspend			1
 #define INCLUDE_vTaskDelayUntil			1
 #define INCLUDE_vTaskDelay				1
+#define INCLUDE_uxTaskGetStackHighWaterMark	1 //For STACK_PROFILE
+#define INCLUDE_xTaskGetIdleTaskHandle		1
+#define INCLUDE_xTimerGetTimerDaemonTaskHandle	1
 
 /* Normal assert() semantics without relying on the provision of an assert.h
 header file. */
-#define configASSERT( x ) if( ( x ) == 0 ) { taskDISABLE_INTERRUPTS(); for( ;; ); }
+//Reports the file and line with polled UART output, as the transmit interrupt can't run, then stops. In rtos_tasks.c
+extern void vAssertCalled( const char *pcFile, uint32_t ulLine );
+#define configASSERT( x ) if( ( x ) == 0 ) { taskDISABLE_INTERRUPTS(); vAssertCalled( __FILE__, __LINE__ ); }
 
 /* Definitions that map the FreeRTOS port interrupt handlers to their CMSIS
 standard names - or at least those used in the unmodified vector table. */
 #define vPortSVCHandler SVC_Handler
 #define xPortPendSVHandler PendSV_Handler
-#define xPortSysTickHandler SysTick_Handler
+//SysTick_Handler is in stats.c, which times xPortSysTickHandler
+
+/* Trace hooks. Events go to the RAM buffer in trace.c, see trace.h */
+#if TRACE_ENABLE
+#define traceTASK_SWITCHED_IN()					traceRecord(TRACE_TASK_IN, pxCurrentTCB->uxTCBNumber, 0)
+#define traceTASK_SWITCHED_OUT()				traceRecord(TRACE_TASK_OUT, pxCurrentTCB->uxTCBNumber, 0)
+#define traceQUEUE_SEND(pxQueue)				traceRecord(TRACE_QUEUE_SEND, (pxQueue)->uxQueueNumber, (pxQueue)->ucQueueType)
+#define traceQUEUE_RECEIVE(pxQueue)				traceRecord(TRACE_QUEUE_RECEIVE, (pxQueue)->uxQueueNumber, (pxQueue)->ucQueueType)
+#define traceQUEUE_SEND_FROM_ISR(pxQueue)		traceRecord(TRACE_QUEUE_SEND_FROM_ISR, (pxQueue)->uxQueueNumber, (pxQueue)->ucQueueType)
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue)	traceRecord(TRACE_QUEUE_RECEIVE_FROM_ISR, (pxQueue)->uxQueueNumber, (pxQueue)->ucQueueType)
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue)	traceRecord(TRACE_QUEUE_BLOCK_SEND, (pxQueue)->uxQueueNumber, (pxQueue)->ucQueueType)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue)	traceRecord(TRACE_QUEUE_BLOCK_RECEIVE, (pxQueue)->uxQueueNumber, (pxQueue)->ucQueueType)
+#define traceTASK_NOTIFY()						traceRecord(TRACE_NOTIFY, pxTCB->uxTCBNumber, (uint16_t)pxTCB->ulNotifiedValue)
+#define traceTASK_NOTIFY_FROM_ISR()				traceRecord(TRACE_NOTIFY_FROM_ISR, pxTCB->uxTCBNumber, (uint16_t)pxTCB->ulNotifiedValue)
+#define traceTASK_NOTIFY_GIVE_FROM_ISR()		traceRecord(TRACE_NOTIFY_FROM_ISR, pxTCB->uxTCBNumber, (uint16_t)pxTCB->ulNotifiedValue)
+#define traceTASK_NOTIFY_TAKE()					traceRecord(TRACE_NOTIFY_TAKE, pxCurrentTCB->uxTCBNumber, (uint16_t)pxCurrentTCB->ulNotifiedValue)
+#define traceTASK_NOTIFY_WAIT()					traceRecord(TRACE_NOTIFY_TAKE, pxCurrentTCB->uxTCBNumber, (uint16_t)pxCurrentTCB->ulNotifiedValue)
+#define traceTASK_NOTIFY_TAKE_BLOCK()			traceRecord(TRACE_NOTIFY_BLOCK, pxCurrentTCB->uxTCBNumber, 0)
+#define traceTASK_NOTIFY_WAIT_BLOCK()			traceRecord(TRACE_NOTIFY_BLOCK, pxCurrentTCB->uxTCBNumber, 0)
+#endif
 
 #endif /* FREERTOS_CONFIG_H */
 
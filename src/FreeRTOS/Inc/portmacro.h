@@ -127,6 +127,17 @@ extern void vPortYield( void );
 #define portYIELD_FROM_ISR( x ) portEND_SWITCHING_ISR( x )
 /*-----------------------------------------------------------*/
 
+/* Tickless idle support, using the LPTMR.  See port.c. */
+#if( configUSE_TICKLESS_IDLE == 1 )
+	extern void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime );
+	#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) vPortSuppressTicksAndSleep( xExpectedIdleTime )
+
+	/* Sleeps taken, and ticks spent asleep. */
+	extern volatile uint32_t ulPortSleepCount;
+	extern volatile uint32_t ulPortSleepTicks;
+#endif
+/*-----------------------------------------------------------*/
+
 /* Critical section management. */
 extern void vPortEnterCritical( void );
 extern void vPortExitCritical( void );
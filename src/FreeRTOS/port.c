@@ -75,19 +75,42 @@
 #include "FreeRTOS.h"
 #include "task.h"
 
+#if( configUSE_TICKLESS_IDLE == 1 )
+	#include "stats.h"	/* The run-time stats clock times sleeps. */
+#endif
+
 /* Constants required to manipulate the NVIC. */
 #define portNVIC_SYSTICK_CTRL		( ( volatile uint32_t *) 0xe000e010 )
 #define portNVIC_SYSTICK_LOAD		( ( volatile uint32_t *) 0xe000e014 )
+#define portNVIC_SYSTICK_CURRENT	( ( volatile uint32_t *) 0xe000e018 )
 #define portNVIC_INT_CTRL			( ( volatile uint32_t *) 0xe000ed04 )
 #define portNVIC_SYSPRI2			( ( volatile uint32_t *) 0xe000ed20 )
 #define portNVIC_SYSTICK_CLK		0x00000004
 #define portNVIC_SYSTICK_INT		0x00000002
 #define portNVIC_SYSTICK_ENABLE		0x00000001
 #define portNVIC_PENDSVSET			0x10000000
+#define portNVIC_PENDSTSET			0x04000000
 #define portMIN_INTERRUPT_PRIORITY	( 255UL )
 #define portNVIC_PENDSV_PRI			( portMIN_INTERRUPT_PRIORITY << 16UL )
 #define portNVIC_SYSTICK_PRI		( portMIN_INTERRUPT_PRIORITY << 24UL )
 
+/* Constants required to use the KL46Z low power timer (LPTMR0) for tickless
+idle. */
+#define portSIM_SCGC5				( ( volatile uint32_t *) 0x40048038 )
+#define portSIM_SCGC5_LPTMR			0x00000001
+#define portLPTMR_CSR				( ( volatile uint32_t *) 0x40040000 )
+#define portLPTMR_PSR				( ( volatile uint32_t *) 0x40040004 )
+#define portLPTMR_CMR				( ( volatile uint32_t *) 0x40040008 )
+#define portLPTMR_CNR				( ( volatile uint32_t *) 0x4004000c )
+#define portLPTMR_CSR_TEN			0x00000001
+#define portLPTMR_CSR_TIE			0x00000040
+#define portLPTMR_CSR_TCF			0x00000080
+#define portLPTMR_PSR_PBYP_LPO		0x00000005	/* Bypass the prescaler, clock from the 1kHz LPO. */
+#define portLPTMR_IRQ				28
+#define portNVIC_ISER				( ( volatile uint32_t *) 0xe000e100 )
+#define portNVIC_ICPR				( ( volatile uint32_t *) 0xe000e280 )
+#define portLPTMR_MAX_TICKS			0xffffUL	/* CMR is 16 bits. */
+
 /* Constants required to set up the initial stack. */
 #define portINITIAL_XPSR			( 0x01000000 )
 
@@ -110,6 +133,21 @@ void xPortPendSVHandler( void );
 void xPortSysTickHandler( void );
 void vPortSVCHandler( void );
 
+#if( configUSE_TICKLESS_IDLE == 1 )
+	/*
+	 * The LPTMR only has to wake the core from WFI, so its handler just clears
+	 * the flag.
+	 */
+	void LPTimer_IRQHandler( void );
+
+	/*
+	 * Number of times the core has slept, and the ticks spent asleep.  Ticks
+	 * asleep divided by the tick count is the sleep residency.
+	 */
+	volatile uint32_t ulPortSleepCount = 0;
+	volatile uint32_t ulPortSleepTicks = 0;
+#endif
+
 /*
  * Start first task is a separate function so it can be tested in isolation.
  */
@@ -344,6 +382,158 @@ void prvSetupTimerInterrupt( void )
 	/* Configure SysTick to interrupt at the requested rate. */
 	*(portNVIC_SYSTICK_LOAD) = ( configCPU_CLOCK_HZ / configTICK_RATE_HZ ) - 1UL;
 	*(portNVIC_SYSTICK_CTRL) = portNVIC_SYSTICK_CLK | portNVIC_SYSTICK_INT | portNVIC_SYSTICK_ENABLE;
+
+	#if( configUSE_TICKLESS_IDLE == 1 )
+	{
+		/* The LPTMR times idle periods.  It runs from the 1kHz LPO, so one
+		count is one tick. */
+		*(portSIM_SCGC5) |= portSIM_SCGC5_LPTMR;
+		*(portLPTMR_CSR) = 0;
+		*(portLPTMR_PSR) = portLPTMR_PSR_PBYP_LPO;
+		*(portNVIC_ICPR) = 1UL << portLPTMR_IRQ;
+		*(portNVIC_ISER) = 1UL << portLPTMR_IRQ;
+	}
+	#endif
 }
 /*-----------------------------------------------------------*/
 
+#if( configUSE_TICKLESS_IDLE == 1 )
+
+	/* The LPTMR counts the 1kHz LPO, so tickless idle needs a 1ms tick.
+	configTICK_RATE_HZ has a cast, so it can't be checked with #if. */
+	typedef char portTICKLESS_NEEDS_1MS_TICK[ ( configTICK_RATE_HZ == 1000 ) ? 1 : -1 ];
+
+	#if( configEXPECTED_IDLE_TIME_BEFORE_SLEEP < 8 )
+		#error Short idle periods should use WFI with SysTick running. The LPTMR margin needs at least 8 ticks
+	#endif
+
+	void LPTimer_IRQHandler( void )
+	{
+		*(portLPTMR_CSR) |= portLPTMR_CSR_TCF;
+	}
+	/*-----------------------------------------------------------*/
+
+	/*
+	 * Restart SysTick so the next tick comes after ulCycles, then carry on
+	 * with full periods.  The counter takes the reload value on the clock
+	 * after it is enabled, and then not again until it reaches zero, so LOAD
+	 * can be set back once the enable has gone through.
+	 */
+	static void prvRestartTick( uint32_t ulCycles )
+	{
+		if( ulCycles < 2UL )
+		{
+			ulCycles = 2UL;
+		}
+		*(portNVIC_SYSTICK_LOAD) = ulCycles - 1UL;
+		*(portNVIC_SYSTICK_CURRENT) = 0UL;
+		*(portNVIC_SYSTICK_CTRL) = portNVIC_SYSTICK_CLK | portNVIC_SYSTICK_INT | portNVIC_SYSTICK_ENABLE;
+		__dsb( portSY_FULL_READ_WRITE );
+		*(portNVIC_SYSTICK_LOAD) = ( configCPU_CLOCK_HZ / configTICK_RATE_HZ ) - 1UL;
+	}
+	/*-----------------------------------------------------------*/
+
+	/*
+	 * Called by the idle task when nothing is due for at least
+	 * configEXPECTED_IDLE_TIME_BEFORE_SLEEP ticks.  Shorter idle periods are
+	 * spent in WFI from the idle hook with SysTick running.
+	 *
+	 * SysTick is stopped, keeping what was left of the tick in progress, and
+	 * the LPTMR is set to wake the core a little before the next task is
+	 * due.  Any other interrupt (USB, buttons, the stats timer overflow) also
+	 * wakes it early.  The LPO that clocks the LPTMR isn't synchronised to
+	 * the core clock, and isn't accurate, so the time actually slept is
+	 * measured with the run-time stats clock, which keeps counting in sleep.
+	 * SysTick is then restarted with whatever is left of the tick the core
+	 * woke in, as the stock ports do, so the tick count keeps real time.
+	 */
+	void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+	{
+	const uint32_t ulCyclesPerTick = configCPU_CLOCK_HZ / configTICK_RATE_HZ;
+	const uint32_t ulCyclesPerCount = configCPU_CLOCK_HZ / STATS_TIMER_HZ;
+	uint32_t ulRemaining, ulStart, ulElapsed, ulTicksSlept, ulLptmrTicks;
+
+		if( xExpectedIdleTime > portLPTMR_MAX_TICKS )
+		{
+			xExpectedIdleTime = portLPTMR_MAX_TICKS;
+		}
+
+		/* Interrupts are masked here so nothing can be made ready between
+		the check below and the WFI.  A pending interrupt still ends the WFI. */
+		__disable_irq();
+		__dsb( portSY_FULL_READ_WRITE );
+		__isb( portSY_FULL_READ_WRITE );
+
+		/* Stop SysTick, keeping the part of the tick still to run. */
+		ulStart = portGET_RUN_TIME_COUNTER_VALUE();
+		*(portNVIC_SYSTICK_CTRL) = portNVIC_SYSTICK_CLK | portNVIC_SYSTICK_INT;
+		ulRemaining = *(portNVIC_SYSTICK_CURRENT);
+		if( ulRemaining == 0UL )
+		{
+			ulRemaining = ulCyclesPerTick;
+		}
+
+		if( eTaskConfirmSleepModeStatus() == eAbortSleep )
+		{
+			/* A task became ready, or a context switch is pending.  Carry on
+			with the tick that was in progress. */
+			prvRestartTick( ulRemaining );
+			__enable_irq();
+			return;
+		}
+
+		/* Wake on the LPTMR before the next task is due, allowing a tick and
+		an eighth for the LPO being out of step and off frequency.  SysTick
+		runs the rest of the way.  The compare flag is set when CNR equals
+		CMR and the counter next increments, so CMR is one less than the
+		period. */
+		ulLptmrTicks = xExpectedIdleTime - 1UL - ( xExpectedIdleTime / 8UL );
+		*(portLPTMR_CSR) = 0;
+		*(portLPTMR_CMR) = ulLptmrTicks - 1UL;
+		*(portLPTMR_CSR) = portLPTMR_CSR_TEN | portLPTMR_CSR_TIE;
+
+		__dsb( portSY_FULL_READ_WRITE );
+		__wfi();
+		__isb( portSY_FULL_READ_WRITE );
+
+		/* Disabling the LPTMR clears the counter and the flag.  Clear the
+		interrupt too, so the handler doesn't run for nothing. */
+		*(portLPTMR_CSR) = portLPTMR_CSR_TCF;
+		*(portNVIC_ICPR) = 1UL << portLPTMR_IRQ;
+
+		/* Work out how many tick boundaries were crossed, and how far into
+		the tick the core is now.  The stats clock has a resolution of
+		ulCyclesPerCount, and the few instructions between the reads and
+		SysTick starting or stopping aren't counted. */
+		ulElapsed = ( portGET_RUN_TIME_COUNTER_VALUE() - ulStart ) * ulCyclesPerCount;
+		if( ulElapsed < ulRemaining )
+		{
+			ulTicksSlept = 0UL;
+			ulRemaining -= ulElapsed;
+		}
+		else
+		{
+			ulElapsed -= ulRemaining;
+			ulTicksSlept = 1UL + ( ulElapsed / ulCyclesPerTick );
+			ulRemaining = ulCyclesPerTick - ( ulElapsed % ulCyclesPerTick );
+
+			/* The LPTMR fires before the next task is due, so this only
+			trips if something held the core for a long time after waking.
+			The tick count can't be stepped onto or past an unblock time. */
+			if( ulTicksSlept > xExpectedIdleTime - 1UL )
+			{
+				ulTicksSlept = xExpectedIdleTime - 1UL;
+			}
+		}
+
+		prvRestartTick( ulRemaining );
+		vTaskStepTick( ulTicksSlept );
+		ulPortSleepCount++;
+		ulPortSleepTicks += ulTicksSlept;
+
+		__enable_irq();
+	}
+
+#endif /* configUSE_TICKLESS_IDLE */
+/*-----------------------------------------------------------*/
+
@@ -0,0 +1,53 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Interrupt driven, debounced button events
+//Each switch edge is caught by a pin change interrupt and timestamped straight away
+//The pin interrupt is then locked out for BUTTONS_DEBOUNCE_MS while the contacts bounce
+//Edges are queued in a FIFO, so presses shorter than a report period are not lost
+#ifndef BUTTONS_H
+#define BUTTONS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+
+//Time to ignore the pin after an edge
+#define BUTTONS_DEBOUNCE_MS 5
+
+//Number of edges that can be waiting. Must be a power of 2
+#define BUTTONS_FIFO_SIZE 16
+
+typedef enum
+{
+	BUTTON_SW1 = 0,
+	BUTTON_SW2,
+	BUTTON_COUNT
+} button_t;
+
+typedef struct
+{
+	uint32_t time; //statsTimerRead() when the edge was seen, so gather can time the report that carries it
+	uint8_t button; //button_t
+	bool pressed; //True for a press, false for a release
+} buttonEvent_t;
+
+//Must be called after gpio_init and before the scheduler starts
+void buttons_init(void);
+
+//Take the oldest edge. Returns false if there are none
+bool buttonsGetEvent(buttonEvent_t *event);
+//Look at the oldest edge without taking it. Returns false if there are none
+bool buttonsPeekEvent(buttonEvent_t *event);
+
+//Debounced state of a button, as of the newest queued edge
+bool buttonsPressed(button_t button);
+
+//Number of edges lost because the FIFO was full
+extern volatile uint32_t buttonsDropped;
+
+//Number of times a debounce timer couldn't be started, so an edge went without a lockout
+extern volatile uint32_t buttonsTimerFailed;
+
+#endif
@@ -0,0 +1,197 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Interrupt driven, debounced button events
+//The first edge is taken as soon as it happens, then the pin interrupt is disabled and a one shot timer started
+//When the timer expires the pin is sampled again. If it has settled somewhere else, that is another edge, and the lockout is restarted
+//Otherwise the pin interrupt is turned back on
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <MKL46Z4.H>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "gpio.h"
+#include "stats.h" //For timestamping edges
+#include "buttons.h"
+
+#define BUTTONS_FIFO_MASK (BUTTONS_FIFO_SIZE-1)
+
+//Pin control value for an interrupt on either edge
+#define BUTTONS_IRQC_EITHER_EDGE 0xB
+
+static const struct
+{
+	PORT_Type *port;
+	GPIO_Type *gpio;
+	uint8_t pin;
+} buttonPins[BUTTON_COUNT] = {
+	{SW1_PORT, SW1_GPIO, SW1_PIN},
+	{SW2_PORT, SW2_GPIO, SW2_PIN}
+};
+
+static TimerHandle_t debounceTimer[BUTTON_COUNT];
+static StaticTimer_t debounceTimerBuffer[BUTTON_COUNT];
+static volatile bool buttonState[BUTTON_COUNT];
+
+//Single consumer FIFO of edges
+//Edges are pushed from the pin interrupt, or from the timer task with interrupts disabled, so pushes never overlap
+//The indices run freely and are masked on use, so head == tail is empty and head - tail == size is full
+static buttonEvent_t fifo[BUTTONS_FIFO_SIZE];
+static volatile uint8_t fifoHead = 0;
+static volatile uint8_t fifoTail = 0;
+
+volatile uint32_t buttonsDropped = 0;
+volatile uint32_t buttonsTimerFailed = 0;
+
+//1 = pressed, as readSW1()
+static bool readPin(uint8_t button)
+{
+	return (buttonPins[button].gpio->PDIR & (1u<<buttonPins[button].pin)) ? false : true;
+}
+
+//Turn the pin interrupt off and clear any pending edge (ISF is write 1 to clear)
+static void pinIrqDisable(uint8_t button)
+{
+	PORT_Type *port = buttonPins[button].port;
+	uint8_t pin = buttonPins[button].pin;
+	port->PCR[pin] = (port->PCR[pin] & ~PORT_PCR_IRQC_MASK) | PORT_PCR_ISF_MASK;
+}
+
+//Clear any edge seen during the lockout and turn the pin interrupt back on
+static void pinIrqEnable(uint8_t button)
+{
+	PORT_Type *port = buttonPins[button].port;
+	uint8_t pin = buttonPins[button].pin;
+	port->PCR[pin] = (port->PCR[pin] & ~PORT_PCR_IRQC_MASK) | PORT_PCR_ISF_MASK | PORT_PCR_IRQC(BUTTONS_IRQC_EITHER_EDGE);
+}
+
+//Must be called from the pin interrupt or with interrupts disabled
+static void buttonsPush(uint8_t button, bool pressed, uint32_t time)
+{
+	uint8_t head = fifoHead;
+
+	buttonState[button] = pressed;
+
+	if((uint8_t)(head - fifoTail) >= BUTTONS_FIFO_SIZE)
+	{
+		buttonsDropped++;
+		return;
+	}
+
+	fifo[head & BUTTONS_FIFO_MASK].time = time;
+	fifo[head & BUTTONS_FIFO_MASK].button = button;
+	fifo[head & BUTTONS_FIFO_MASK].pressed = pressed;
+
+	//The entry must be written before the consumer can see it
+	__DMB();
+	fifoHead = head + 1;
+}
+
+//End of the lockout for one button
+static void buttonsDebounceDone(TimerHandle_t timer)
+{
+	uint8_t button = (uint8_t)(uint32_t)pvTimerGetTimerID(timer);
+	bool relock = false;
+
+	taskENTER_CRITICAL();
+	bool level = readPin(button);
+	if(level != buttonState[button])
+	{
+		//Settled in the other state, or an edge was missed during the lockout
+		//It happened some time during the lockout, so this is up to BUTTONS_DEBOUNCE_MS late
+		buttonsPush(button, level, statsTimerRead());
+		relock = true;
+	} else {
+		pinIrqEnable(button);
+	}
+	taskEXIT_CRITICAL();
+
+	if(relock && xTimerStart(timer, 0) != pdPASS)
+	{
+		//As in the pin interrupt, rather than leave the pin off
+		pinIrqEnable(button);
+		buttonsTimerFailed++;
+	}
+}
+
+void buttons_init(void)
+{
+	for(uint32_t i=0; i<BUTTON_COUNT; i++)
+	{
+		debounceTimer[i] = xTimerCreateStatic("Debounce", BUTTONS_DEBOUNCE_MS/portTICK_RATE_MS, pdFALSE, (void *)i, buttonsDebounceDone, &debounceTimerBuffer[i]);
+		buttonState[i] = readPin(i);
+		pinIrqEnable(i);
+	}
+
+	//The interrupt starts the debounce timers, so it must be at an API safe level
+	NVIC_SetPriority(PORTC_PORTD_IRQn, configMAX_API_CALL_INTERRUPT_PRIORITY);
+	NVIC_ClearPendingIRQ(PORTC_PORTD_IRQn);
+	NVIC_EnableIRQ(PORTC_PORTD_IRQn);
+}
+
+bool buttonsPeekEvent(buttonEvent_t *event)
+{
+	uint8_t tail = fifoTail;
+
+	if(tail == fifoHead)
+	{
+		return false;
+	}
+
+	//Don't read the entry before seeing the head that covers it
+	__DMB();
+	*event = fifo[tail & BUTTONS_FIFO_MASK];
+	return true;
+}
+
+bool buttonsGetEvent(buttonEvent_t *event)
+{
+	if(!buttonsPeekEvent(event))
+	{
+		return false;
+	}
+
+	//Finish reading the entry before handing it back to the producer
+	__DMB();
+	fifoTail = fifoTail + 1;
+	return true;
+}
+
+bool buttonsPressed(button_t button)
+{
+	return buttonState[button];
+}
+
+void PORTC_PORTD_IRQHandler(void)
+{
+	BaseType_t woken = pdFALSE;
+	uint32_t now = statsTimerRead();
+
+	for(uint8_t i=0; i<BUTTON_COUNT; i++)
+	{
+		if(buttonPins[i].port->PCR[buttonPins[i].pin] & PORT_PCR_ISF_MASK)
+		{
+			//Ignore the pin until the contacts have stopped bouncing
+			pinIrqDisable(i);
+
+			bool level = readPin(i);
+			if(level != buttonState[i])
+			{
+				buttonsPush(i, level, now);
+			}
+
+			//If the timer command queue is full the lockout can't be timed, so don't lock out at all
+			//Otherwise the pin would stay off and the button would be dead until reset
+			if(xTimerStartFromISR(debounceTimer[i], &woken) != pdPASS)
+			{
+				pinIrqEnable(i);
+				buttonsTimerFailed++;
+			}
+		}
+	}
+
+	portEND_SWITCHING_ISR(woken);
+}
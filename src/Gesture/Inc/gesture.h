@@ -0,0 +1,54 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Tilt gesture recogniser
+//Spots a quick flick of the board left or right (tilt out past a threshold and back within a short time)
+//A slow tilt that is held is pointer movement, not a flick, so it is ignored
+//One state machine step per sample, so the cost per sample is fixed
+#ifndef GESTURE_H
+#define GESTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum
+{
+	GESTURE_NONE,
+	GESTURE_FLICK_LEFT,
+	GESTURE_FLICK_RIGHT
+} gesture_t;
+
+//Tuning. Held in RAM so it can be changed at runtime with gestureSetConfig
+typedef struct
+{
+	bool enabled;
+	int16_t onThreshold; //Tilt away from the resting position that starts a flick, in accel counts
+	int16_t offThreshold; //Tilt back under this ends the flick
+	uint16_t maxFlickMs; //A flick must return within this time, otherwise it is a held tilt
+	uint16_t refractoryMs; //Time after a flick before another can start, so the return swing isn't taken as a flick the other way
+} gestureConfig_t;
+
+//Roughly 0.3g out and back inside a quarter of a second
+#define GESTURE_DEFAULT_CONFIG {true, 600, 200, 250, 400}
+
+typedef struct
+{
+	enum {GESTURE_IDLE, GESTURE_OUT, GESTURE_HELD, GESTURE_REFRACTORY} state;
+	int32_t smoothed; //Lightly filtered tilt, << GESTURE_SMOOTH_SHIFT
+	int32_t rest; //Slowly tracked resting tilt, << GESTURE_REST_SHIFT
+	int8_t direction; //-1 or 1 while a flick is in progress
+	uint32_t elapsedMs; //Time in the current state
+} gestureHandle_t;
+
+//Filter lengths, as shifts. Smoothing removes sensor noise, the rest position follows how the board is being held
+#define GESTURE_SMOOTH_SHIFT 2
+#define GESTURE_REST_SHIFT 6
+
+void gestureInit(gestureHandle_t *handle, int16_t tilt);
+gesture_t gestureAddSample(gestureHandle_t *handle, int16_t tilt, uint32_t dtMs);
+
+void gestureSetConfig(const gestureConfig_t *config);
+void gestureGetConfig(gestureConfig_t *config);
+
+#endif
@@ -0,0 +1,101 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gesture.h"
+
+//Shared by every handle. A new config is written to the spare buffer, then published by swapping a single pointer
+//as with the ballistics curve, so a sample never sees half of one config and half of another
+//The pointer is read once per sample. Only the console sets the config, and it runs below the accel task,
+//so it can't write the spare again while a sample is still using it
+//The buffers are volatile too, so the compiler can't move the copy past the swap
+static volatile gestureConfig_t configs[2] = {GESTURE_DEFAULT_CONFIG, GESTURE_DEFAULT_CONFIG};
+static const volatile gestureConfig_t * volatile config = &configs[0];
+
+void gestureSetConfig(const gestureConfig_t *newConfig)
+{
+	volatile gestureConfig_t *spare = (config == &configs[0] ? &configs[1] : &configs[0]);
+	
+	*spare = *newConfig;
+	config = spare;
+}
+
+void gestureGetConfig(gestureConfig_t *current)
+{
+	*current = *config;
+}
+
+//Start with the board resting at the given tilt
+void gestureInit(gestureHandle_t *handle, int16_t tilt)
+{
+	handle->state = GESTURE_IDLE;
+	handle->smoothed = (int32_t)tilt << GESTURE_SMOOTH_SHIFT;
+	handle->rest = (int32_t)tilt << GESTURE_REST_SHIFT;
+	handle->direction = 0;
+	handle->elapsedMs = 0;
+}
+
+//Step the state machine by one sample, dtMs after the last one
+//Returns the gesture completed by this sample, if any
+gesture_t gestureAddSample(gestureHandle_t *handle, int16_t tilt, uint32_t dtMs)
+{
+	const volatile gestureConfig_t *cfg = config;
+	gesture_t result = GESTURE_NONE;
+	
+	handle->smoothed += (int32_t)tilt - (handle->smoothed >> GESTURE_SMOOTH_SHIFT);
+	int32_t level = handle->smoothed >> GESTURE_SMOOTH_SHIFT;
+	int32_t offset = level - (handle->rest >> GESTURE_REST_SHIFT);
+	int32_t magnitude = (offset < 0 ? -offset : offset);
+	
+	switch(handle->state)
+	{
+		case GESTURE_IDLE:
+			if(cfg->enabled && magnitude > cfg->onThreshold)
+			{
+				handle->state = GESTURE_OUT;
+				handle->direction = (offset < 0 ? -1 : 1);
+				handle->elapsedMs = 0;
+			}
+			break;
+		
+		case GESTURE_OUT:
+			handle->elapsedMs += dtMs;
+			if(offset*handle->direction < cfg->offThreshold)
+			{
+				//Back already, so it was a flick
+				result = (handle->direction < 0 ? GESTURE_FLICK_LEFT : GESTURE_FLICK_RIGHT);
+				handle->state = GESTURE_REFRACTORY;
+				handle->elapsedMs = 0;
+			} else if(handle->elapsedMs > cfg->maxFlickMs) {
+				//Still out, so the user is steering
+				handle->state = GESTURE_HELD;
+			}
+			break;
+		
+		case GESTURE_HELD:
+			if(magnitude < cfg->offThreshold)
+			{
+				handle->state = GESTURE_IDLE;
+			}
+			break;
+		
+		case GESTURE_REFRACTORY:
+			handle->elapsedMs += dtMs;
+			if(handle->elapsedMs >= cfg->refractoryMs)
+			{
+				handle->state = GESTURE_IDLE;
+			}
+			break;
+	}
+	
+	//Follow the resting position, but not during a flick, which would drag it along
+	//It is followed while held, so a new grip is eventually taken as the rest position
+	if(handle->state == GESTURE_IDLE || handle->state == GESTURE_HELD)
+	{
+		handle->rest += level - (handle->rest >> GESTURE_REST_SHIFT);
+	}
+	
+	return result;
+}
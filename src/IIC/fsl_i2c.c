@@ -28,6 +28,8 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include "fsl_i2c.h"
+#include "stats.h" /* For timing the I2C0 interrupt */
+#include "trace.h" /* For tracing the I2C0 interrupt */
 
 /*******************************************************************************
  * Definitions
@@ -1609,7 +1611,11 @@ void I2C_SlaveTransferHandleIRQ(I2C_Type *base, void *i2cHandle)
 
 void I2C0_IRQHandler(void)
 {
+    uint32_t start = statsIsrEnter();
+    traceRecord(TRACE_ISR_ENTER, TRACE_ISR_I2C, 0);
     I2C_TransferCommonIRQHandler(I2C0, s_i2cHandle[0]);
+    traceRecord(TRACE_ISR_EXIT, TRACE_ISR_I2C, 0);
+    statsIsrExit(STATS_ISR_I2C, start);
 }
 
 #if (FSL_FEATURE_SOC_I2C_COUNT > 1)
@@ -14,9 +14,13 @@
 #ifdef NDEBUG
 	#define dbg_puts(str)
 	#define dbg_putchar(c)
+	#define dbg_putdec(val)
+	#define dbg_flush()
 #else
 	#define dbg_puts(str) uart_puts(str)
 	#define dbg_putchar(c) uart_putchar(c)
+	#define dbg_putdec(val) uart_putdec(val)
+	#define dbg_flush() uart_flush()
 #endif
 
 
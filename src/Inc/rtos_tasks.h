@@ -10,33 +10,70 @@
 #ifndef HEARTBEAT_H
 #define HEARTBEAT_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
 #include "FreeRTOS.h"
 #include "task.h"
 
 
-//Datatype to be sent via mouseDataQueue
+//Mouse data passed from gather to send
+//In absolute mode x and y are a screen position (0 to MOUSE_ABSOLUTE_MAX)
+//Otherwise they are relative motion
+//pan is horizontal scrolling (AC Pan)
 typedef struct
 {
-	int8_t x;
-	int8_t y;
+	int16_t x;
+	int16_t y;
 	int8_t scroll;
+	int8_t pan;
 	uint8_t btn;
+	bool absolute;
+	uint32_t time; //statsTimerRead() when the oldest motion data in the report was sampled. 0 if there is none
 } mouseData_t;
 
-//Datatype to be sent via peripheralReportQueue
+//Report from a peripheral task to gather
+//TOUCH carries the distance scrolled, and in payload2 whether a finger was on the strip at any sample since the last report
+//ACCEL_ABSOLUTE carries a screen position rather than relative motion
+//btn holds button bits pressed for this report only, e.g. back/forward from a gesture
 typedef struct
 {
-	enum {TOUCH, ACCEL} source;
-	int8_t payload1;
-	int8_t payload2;
+	enum {TOUCH, ACCEL, ACCEL_ABSOLUTE} source;
+	int16_t payload1;
+	int16_t payload2;
+	uint8_t btn;
+	uint32_t time; //statsTimerRead() when the oldest sample in the report was taken
 } peripheralData_t;
 
+//Set to 1 to have heartbeat print each task's stack use every second, with a suggested size
+//Run the device through everything it does (clicks, pan, gestures, absolute mode, USB replug) before reading the table
+#define STACK_PROFILE 0
+
+//Stack sizes, in words
+//None have been measured yet, so every task keeps the 128 words they all had before
+//Build with STACK_PROFILE 1, and only trim a task to its suggested size once the table has been read after the workload above
+#define USB_STACK_SIZE			128 //Runs usb_setup()
+#define GATHER_STACK_SIZE		128
+#define SEND_STACK_SIZE			128
+#define TOUCH_STACK_SIZE		128
+#define ACCEL_STACK_SIZE		128 //The I2C driver is several calls deep
+#define LCD_STACK_SIZE			128
+#define CONSOLE_STACK_SIZE		128 //Holds the command line, and runs the trace dump
+#define HEARTBEAT_STACK_SIZE	128 //Prints the CPU load summary, or the stack report
+
+//Task handles, so tasks can notify each other. Set when the tasks are created
+extern TaskHandle_t heartbeatTaskHandle;
+extern TaskHandle_t lcdTaskHandle;
+extern TaskHandle_t gatherTaskHandle;
+extern TaskHandle_t sendTaskHandle;
+extern TaskHandle_t touchTaskHandle;
+extern TaskHandle_t accelTaskHandle;
+
 void heartbeat(void *pvParameters);
 void gather(void *pvParameters);
 void send(void *pvParameters);
 void touch(void *pvParameters);
 void accel(void *pvParameters);
-void vApplicationMallocFailedHook( void );
 void vApplicationStackOverflowHook( TaskHandle_t xTask, signed char *pcTaskName );
 void lcd(void *pvParameters);
 
@@ -23,8 +23,11 @@
 //From http://www.keil.com/support/docs/1156.htm
 #define BIN_TO_BYTE(b7,b6,b5,b4,b3,b2,b1,b0) ((b7 << 7)+(b6 << 6)+(b5 << 5)+(b4 << 4)+(b3 << 3)+(b2 << 2)+(b1 << 1)+b0)
 
+//Frames are composed in a copy of the waveform registers and written out in one go, so the display never shows a blank frame
+//lcd_setStr, lcd_setNum and lcd_clear commit their frame. lcd_setDigit only changes the copy, so call lcd_commit after it
 void lcd_init(void);
 void lcd_setDigit(uint8_t digit, uint8_t data);
+void lcd_commit(void);
 uint8_t lcd_setStr(const char *str);
 void lcd_setNum(unsigned int num);
 void lcd_clear(void);
@@ -115,6 +115,29 @@ static const uint8_t lcdLetters[] = { BIN_TO_BYTE(0,1,1,1,0,1,1,1), // A
 															 
 static const uint8_t lcdSymbols[10] = { BIN_TO_BYTE(0,0,0,0,0,0,0,0), // Space
                                         BIN_TO_BYTE(0,1,0,0,0,0,0,0)}; // Dash
+
+//Glyphs in the order of lcdGlyphWaveform
+#define LCD_GLYPH_NUMBERS 0
+#define LCD_GLYPH_LETTERS (LCD_GLYPH_NUMBERS + sizeof(lcdNumbers))
+#define LCD_GLYPH_SYMBOLS (LCD_GLYPH_LETTERS + sizeof(lcdLetters))
+#define LCD_GLYPH_COUNT (LCD_GLYPH_SYMBOLS + 2)
+
+//Waveform bytes for each glyph, built from the tables above by lcd_init
+//The low byte goes to the first frontplane of a digit, the high byte to the second
+static uint16_t lcdGlyphWaveform[LCD_GLYPH_COUNT];
+
+//Shadow of LCD->WF. Frames are composed here and only the words that changed are written out
+//The byte view lines up with LCD->WF8B, as the core is little endian
+typedef union
+{
+	uint32_t word[16];
+	uint8_t pin[64];
+} lcd_frame_t;
+
+static lcd_frame_t lcdFrame; //Frame being composed
+static lcd_frame_t lcdShown; //What is in the registers
+
+static uint16_t lcdSegmentsToWaveform(uint8_t data);
 																 
 void lcd_init(void)
 {
@@ -135,7 +158,7 @@ void lcd_init(void)
 	{
 		init_pin(backplanes[i].port, backplanes[i].pin, 0, 0, 0); //Initialise pin
 		backplaneEnableMask |= ( ((uint64_t)1) << backplanes[i].lcd_num); //Activate bit in backplane mask
-		LCD->WF8B[backplanes[i].lcd_num] = (1 << i); //Set backplane 0 to be phase A, backplane 1 to be phase B etc.
+		lcdFrame.pin[backplanes[i].lcd_num] = (1 << i); //Set backplane 0 to be phase A, backplane 1 to be phase B etc.
 	}
 
 	//Mask to set PEN
@@ -149,6 +172,25 @@ void lcd_init(void)
 		pinEnableMask |= ( ((uint64_t)1) << frontplanes[i].lcd_num); //Activate bit in pin mask
 	}
 	
+	//Build the glyph table
+	for(i=0; i<sizeof(lcdNumbers); i++)
+	{
+		lcdGlyphWaveform[LCD_GLYPH_NUMBERS + i] = lcdSegmentsToWaveform(lcdNumbers[i]);
+	}
+	for(i=0; i<sizeof(lcdLetters); i++)
+	{
+		lcdGlyphWaveform[LCD_GLYPH_LETTERS + i] = lcdSegmentsToWaveform(lcdLetters[i]);
+	}
+	lcdGlyphWaveform[LCD_GLYPH_SYMBOLS + LCD_SYM_SPACE] = lcdSegmentsToWaveform(lcdSymbols[LCD_SYM_SPACE]);
+	lcdGlyphWaveform[LCD_GLYPH_SYMBOLS + LCD_SYM_DASH] = lcdSegmentsToWaveform(lcdSymbols[LCD_SYM_DASH]);
+	
+	//Write every word once, so the shadow and the registers agree
+	for(i=0; i<16; i++)
+	{
+		LCD->WF[i] = lcdFrame.word[i];
+	}
+	lcdShown = lcdFrame;
+	
 	//Pin enable
 	LCD->PEN[0] = (uint32_t) (pinEnableMask & 0xFFFFFFFF);
 	LCD->PEN[1] = (uint32_t) ( (pinEnableMask >> 32) & 0xFFFFFFFF);
@@ -164,20 +206,60 @@ void lcd_init(void)
 	LCD->GCR |= LCD_GCR_LCDEN_MASK;
 }
 
-//Set the segments of a digit
-//This assumes all segments are off to start with
+//Turn segment data into the waveform bytes for the two frontplanes of a digit
+//This is the same for every digit, as they all use the same mapping
 //segment data is of the format [dp]gfedcba (a=lsb, dp=msb)
-void lcd_setDigit(uint8_t digit, uint8_t data)
+static uint16_t lcdSegmentsToWaveform(uint8_t data)
 {
 	int i;
-	digit_map_t mapping;
+	uint16_t waveform = 0;
 	for(i=0; i<8; i++)
 	{
-		//If we should set the segment
 		if(data & (1 << i))
 		{
-			mapping = digit_map[i];
-			LCD->WF8B[ frontplanes[mapping.fplne_ofst + (digit*2)].lcd_num] |= 1 << mapping.phase;
+			waveform |= 1 << (digit_map[i].phase + (digit_map[i].fplne_ofst * 8));
+		}
+	}
+	return waveform;
+}
+
+//Put the waveform bytes for a digit into the frame being composed
+static void lcdSetDigitWaveform(uint8_t digit, uint16_t waveform)
+{
+	lcdFrame.pin[frontplanes[digit*2].lcd_num] = (uint8_t) waveform;
+	lcdFrame.pin[frontplanes[(digit*2) + 1].lcd_num] = (uint8_t) (waveform >> 8);
+}
+
+//Blank every digit in the frame being composed. The backplanes are left alone
+static void lcdBlankFrame(void)
+{
+	int i;
+	for(i=0; i<NUM_DIGITS; i++)
+	{
+		lcdSetDigitWaveform(i, 0);
+	}
+}
+
+//Set the segments of a digit in the frame being composed
+//This replaces whatever the digit showed before. Nothing changes on the display until lcd_commit
+//segment data is of the format [dp]gfedcba (a=lsb, dp=msb)
+void lcd_setDigit(uint8_t digit, uint8_t data)
+{
+	lcdSetDigitWaveform(digit, lcdSegmentsToWaveform(data));
+}
+
+//Write the words of the frame that differ from the display
+//Each word write is atomic, and the writes are back to back, so at worst one LCD frame shows a mix of old and new digits
+//There is never a blank frame between them
+void lcd_commit(void)
+{
+	int i;
+	for(i=0; i<16; i++)
+	{
+		if(lcdFrame.word[i] != lcdShown.word[i])
+		{
+			LCD->WF[i] = lcdFrame.word[i];
+			lcdShown.word[i] = lcdFrame.word[i];
 		}
 	}
 }
@@ -187,39 +269,41 @@ void lcd_setDigit(uint8_t digit, uint8_t data)
 //Return 0 if not
 uint8_t lcd_setStr(const char *str)
 {
-	lcd_clear(); //Clear LCD
+	lcdBlankFrame();
 	
 	int i;
 	char c;
-	uint8_t dispByte;
+	uint8_t glyph;
 	for(i=0; i< NUM_DIGITS; i++)
 	{
 		c = str[i];
-		//Return if at the end of the string
+		//Stop if at the end of the string
 		if(c == '\0')
 		{
-			return 1;
+			break;
 		}
 		
-		//Get byte to display
+		//Get glyph to display
 		if(c >= 'a' && c <= 'z') //If lower case
 		{
-			dispByte = lcdLetters[c - 'a'];
+			glyph = LCD_GLYPH_LETTERS + (c - 'a');
 		} else if(c >= 'A' && c <= 'Z') { //If upper case
-			dispByte = lcdLetters[c - 'A'];
+			glyph = LCD_GLYPH_LETTERS + (c - 'A');
 		} else if(c >= '0' && c <= '9') { //If number
-			dispByte = lcdNumbers[c - '0'];
+			glyph = LCD_GLYPH_NUMBERS + (c - '0');
 		} else if(c == ' ') { //Special case for space
-			dispByte = lcdSymbols[LCD_SYM_SPACE];
+			glyph = LCD_GLYPH_SYMBOLS + LCD_SYM_SPACE;
 		} else if(c == '-') { //Special case for dash
-			dispByte = lcdSymbols[LCD_SYM_DASH];
+			glyph = LCD_GLYPH_SYMBOLS + LCD_SYM_DASH;
 		} else { //Invalid/unsupported character
 			while(1);
 		}
 		
-		lcd_setDigit(LCD_DIGIT(i), dispByte);
+		lcdSetDigitWaveform(LCD_DIGIT(i), lcdGlyphWaveform[glyph]);
 	}
 	
+	lcd_commit();
+	
 	//Check if the next character is null termination
 	//I.e. the entire string is displayed
 	if(str[i] == '\0')
@@ -248,7 +332,7 @@ void lcd_setNum(unsigned int num)
 		num = (SET_NUM_MULT * 10) -1;
 	}
 	
-	lcd_clear(); //Clear LCD
+	lcdBlankFrame();
 	
 	for(i=0; i< NUM_DIGITS; i++)
 	{
@@ -261,28 +345,17 @@ void lcd_setNum(unsigned int num)
 		//Or if it's the last digit (as we want at least one zero)
 		if(digit != 0 || digitWritten || i == NUM_DIGITS-1)
 		{
-			lcd_setDigit(LCD_DIGIT(i), lcdNumbers[digit]);
+			lcdSetDigitWaveform(LCD_DIGIT(i), lcdGlyphWaveform[LCD_GLYPH_NUMBERS + digit]);
 			digitWritten = true;
 		}
 	}
 	
+	lcd_commit();
 }
 
 //Clear LCD
 void lcd_clear(void)
 {
-	int i;
-	
-	//Clear all segments and backplanes
-	for(i=0; i<16; i++)
-	{
-		LCD->WF[i] = 0;
-	}
-	
-	
-	//Re-enable backplanes
-	for(i=0; i<noBackplanes; i++)
-	{
-		LCD->WF8B[backplanes[i].lcd_num] = (1 << i); //Set backplane 0 to be phase A, backplane 1 to be phase B etc.
-	}
+	lcdBlankFrame();
+	lcd_commit();
 }
@@ -0,0 +1,47 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Deferred binary logging
+//A call logs a message ID from log_messages.h and its arguments as raw words. No formatting is done on the target
+//Each message is sent as one FRAME_LOG packet (see frame.h), written straight into the UART transmit buffer. The payload is:
+//  ID, 32 bit stats clock timestamp (little endian), then each argument as a zigzag varint. The payload length gives the count
+//Measured against the LOG_BINARY 0 text line, which has no timestamp: boot 11 bytes vs 18, heartbeat 11 vs 11,
+//UART baud 15 vs 33, latency 21 vs 55. About 2-3 times smaller for messages with arguments, not an order of magnitude.
+//The real saving is the formatting work taken off the target
+//The packets can be mixed with plain text and telemetry. tools/log_decode.py turns them back into text
+//Set LOG_BINARY to 0 to format messages as text on the target instead, for use with a plain terminal
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+
+#define LOG_BINARY 1
+
+//Most arguments one message can have
+#define LOG_MAX_ARGS 6
+
+typedef enum
+{
+#define LOG_MESSAGE(id, format) id,
+#include "log_messages.h"
+#undef LOG_MESSAGE
+	LOG_NUM_MESSAGES
+} logId_t;
+
+//Send one message. Use LOG_MSG and LOG_MSG0 rather than calling this directly
+//Safe from tasks and interrupts. Dropped and counted in uartDropped if the UART buffer is full
+void logWrite(logId_t id, uint8_t count, const uint32_t *args);
+
+//Log a message with arguments, which are each converted to a 32 bit word
+//LOG_MSG(LOG_UART_DROPPED, dropped);
+//Like debug.h, compiled out if NDEBUG is defined
+#ifdef NDEBUG
+	#define LOG_MSG(id, ...)
+	#define LOG_MSG0(id)
+#else
+	#define LOG_MSG(id, ...) logWrite((id), sizeof((uint32_t[]){__VA_ARGS__})/sizeof(uint32_t), (uint32_t[]){__VA_ARGS__})
+	#define LOG_MSG0(id) logWrite((id), 0, 0)
+#endif
+
+#endif
@@ -0,0 +1,18 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Every message that can be logged, as LOG_MESSAGE(id, format)
+//The message ID is its position in this list, so it must match the firmware that made the log
+//tools/log_decode.py reads this file to turn IDs back into text, so keep one entry per line
+//Formats may use %u, %d and %x. Each takes one argument word
+
+//No include guard, as it is included once for each use of LOG_MESSAGE
+
+LOG_MESSAGE(LOG_BOOT, "USB Mouse begin.")
+LOG_MESSAGE(LOG_HEARTBEAT, "Heartbeat")
+LOG_MESSAGE(LOG_UART_DROPPED, "UART dropped %u")
+LOG_MESSAGE(LOG_LATENCY, "Latency us: n %u min %u avg %u p99 %u max %u")
+LOG_MESSAGE(LOG_TELEMETRY_DROPPED, "Telemetry dropped %u")
+LOG_MESSAGE(LOG_UART_BAUD, "UART %u baud, error %d ppm")
+LOG_MESSAGE(LOG_SLEEP, "Sleep %u times, %u of %u ticks")
@@ -0,0 +1,113 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+#include <stdint.h>
+#include "uart.h"
+#include "stats.h"
+#include "frame.h"
+#include "log.h"
+
+#if LOG_BINARY
+
+//ID, timestamp
+#define LOG_HEADER_SIZE 5
+
+//Most bytes a varint of a 32 bit word can take
+#define LOG_VARINT_MAX 5
+
+void logWrite(logId_t id, uint8_t count, const uint32_t *args)
+{
+	uint8_t payload[LOG_HEADER_SIZE + LOG_MAX_ARGS*LOG_VARINT_MAX];
+	uint8_t *p = payload;
+	uint32_t time = statsTimerRead();
+	
+	if(count > LOG_MAX_ARGS)
+	{
+		count = LOG_MAX_ARGS;
+	}
+	
+	*p++ = (uint8_t)id;
+	for(int i=0; i<4; i++)
+	{
+		*p++ = (uint8_t)(time >> (i*8));
+	}
+	for(uint8_t n=0; n<count; n++)
+	{
+		//Zigzag, so small negative numbers are small too: 0, -1, 1, -2... become 0, 1, 2, 3...
+		uint32_t val = (args[n] << 1) ^ (uint32_t)((int32_t)args[n] >> 31);
+		
+		//Then 7 bits a byte, low first. The top bit is set on every byte but the last
+		while(val >= 0x80)
+		{
+			*p++ = (uint8_t)(val | 0x80);
+			val >>= 7;
+		}
+		*p++ = (uint8_t)val;
+	}
+	
+	frameSend(FRAME_LOG, payload, p - payload);
+}
+
+#else
+
+static const char * const formats[LOG_NUM_MESSAGES] = {
+#define LOG_MESSAGE(id, format) format,
+#include "log_messages.h"
+#undef LOG_MESSAGE
+};
+
+//Longest formatted line
+#define LOG_LINE_SIZE 96
+
+//Write val at p in the given base, and return the new end
+static char *logNumber(char *p, char *end, uint32_t val, uint32_t base)
+{
+	char digits[10];
+	int n = 0;
+	
+	do
+	{
+		digits[n++] = "0123456789abcdef"[val % base];
+		val /= base;
+	} while(val);
+	
+	while(n && p < end)
+	{
+		*p++ = digits[--n];
+	}
+	return p;
+}
+
+void logWrite(logId_t id, uint8_t count, const uint32_t *args)
+{
+	char line[LOG_LINE_SIZE];
+	char *p = line;
+	char *end = &line[LOG_LINE_SIZE-3]; //Room for CR, LF and terminator
+	const char *f = formats[id];
+	uint8_t n = 0;
+	
+	while(*f && p < end)
+	{
+		if(f[0] == '%' && (f[1] == 'u' || f[1] == 'd' || f[1] == 'x') && n < count)
+		{
+			uint32_t val = args[n++];
+			if(f[1] == 'd' && (int32_t)val < 0)
+			{
+				*p++ = '-';
+				val = -val;
+			}
+			p = logNumber(p, end, val, (f[1] == 'x') ? 16 : 10);
+			f += 2;
+		} else {
+			*p++ = *f++;
+		}
+	}
+	*p++ = '\r';
+	*p++ = '\n';
+	*p = '\0';
+	
+	uart_puts(line);
+}
+
+#endif
@@ -0,0 +1,47 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Fixed point motion integrator
+//Integrates velocity over every sample between reports, and hands out whole counts
+//The fractional remainder, and anything over the report limit, is carried into the next report
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <stdint.h>
+
+//Most motion that can be held back for later reports, in counts
+//This stops a long saturated movement from building up a backlog that plays out after the user stops
+//It is two full 8-bit reports, which was the cap when every report was 8-bit. It doesn't scale with the limit,
+//as with the 16-bit report the limit is far more than can move in one report and would cap nothing
+#define MOTION_MAX_BACKLOG (2*INT8_MAX)
+
+typedef struct
+{
+	int32_t acc; //Motion not yet reported, in velocity*ms
+	int32_t divisor; //velocity*ms per output count
+} motionAccumulator_t;
+
+void motionAddSample(motionAccumulator_t *handle, int32_t velocity, uint32_t dtMs);
+int16_t motionTakeCounts(motionAccumulator_t *handle, int16_t limit);
+void motionReset(motionAccumulator_t *handle);
+
+//Kinetic motion
+//Input counts are passed straight through while they keep coming
+//When they stop, motion carries on at the recent speed and slows down, like a flicked wheel
+#define MOTION_KINETIC_SCALE 256 //Fixed point scale of the glide speed
+#define MOTION_KINETIC_DECAY_SHIFT 4 //Glide loses 1/16 of its speed per step
+#define MOTION_KINETIC_MIN_SPEED (MOTION_KINETIC_SCALE/8) //Glide stops below 1/8 count per step
+
+typedef struct
+{
+	motionAccumulator_t motion;
+	int32_t speed; //Counts per step * MOTION_KINETIC_SCALE
+} motionKinetic_t;
+
+#define MOTION_KINETIC_INIT {{0, MOTION_KINETIC_SCALE}, 0}
+
+int16_t motionKineticStep(motionKinetic_t *handle, int16_t input, int16_t limit);
+void motionKineticStop(motionKinetic_t *handle);
+
+#endif
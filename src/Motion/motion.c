@@ -0,0 +1,76 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+#include <stdint.h>
+#include "motion.h"
+
+//Add a velocity sample that applied for dtMs
+void motionAddSample(motionAccumulator_t *handle, int32_t velocity, uint32_t dtMs)
+{
+	handle->acc += velocity * (int32_t)dtMs;
+}
+
+//Take the whole counts accumulated so far, up to +/-limit
+//Division truncates towards zero, so positive and negative motion are treated the same
+//and the remainder stays in the accumulator
+int16_t motionTakeCounts(motionAccumulator_t *handle, int16_t limit)
+{
+	int32_t counts = handle->acc / handle->divisor;
+	
+	//Clamp to what fits in a report. The rest goes in the next report
+	if(counts > limit)
+	{
+		counts = limit;
+	} else if(counts < -limit) {
+		counts = -limit;
+	}
+	
+	handle->acc -= counts * handle->divisor;
+	
+	//Limit the backlog left behind
+	int32_t maxBacklog = handle->divisor * MOTION_MAX_BACKLOG;
+	if(handle->acc > maxBacklog)
+	{
+		handle->acc = maxBacklog;
+	} else if(handle->acc < -maxBacklog) {
+		handle->acc = -maxBacklog;
+	}
+	
+	return (int16_t)counts;
+}
+
+//Throw away any motion not yet reported
+void motionReset(motionAccumulator_t *handle)
+{
+	handle->acc = 0;
+}
+
+//Step kinetic motion by one report, with input counts since the last step
+//Returns the counts to report, up to +/-limit
+int16_t motionKineticStep(motionKinetic_t *handle, int16_t input, int16_t limit)
+{
+	if(input != 0)
+	{
+		//Follow the input. The glide speed is averaged over the last few steps so one jerky sample doesn't set it
+		motionAddSample(&handle->motion, (int32_t)input * MOTION_KINETIC_SCALE, 1);
+		handle->speed += (((int32_t)input * MOTION_KINETIC_SCALE) - handle->speed) / 2;
+	} else if(handle->speed != 0) {
+		//Glide
+		motionAddSample(&handle->motion, handle->speed, 1);
+		handle->speed -= handle->speed / (1 << MOTION_KINETIC_DECAY_SHIFT);
+		if(handle->speed < MOTION_KINETIC_MIN_SPEED && handle->speed > -MOTION_KINETIC_MIN_SPEED)
+		{
+			handle->speed = 0;
+		}
+	}
+	
+	return motionTakeCounts(&handle->motion, limit);
+}
+
+//Stop any glide and throw away motion not yet reported
+void motionKineticStop(motionKinetic_t *handle)
+{
+	motionReset(&handle->motion);
+	handle->speed = 0;
+}
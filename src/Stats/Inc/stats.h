@@ -0,0 +1,56 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//CPU time accounting
+//FreeRTOS run-time stats are clocked from TPM2, extended to 32 bits in software
+//The busiest interrupts are timed as well, and heartbeat prints a summary every second
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+//TPM2 counts the 48MHz PLL/2 clock divided by 2^STATS_TIMER_PRESCALE_SHIFT (750kHz)
+#define STATS_TIMER_PRESCALE_SHIFT 6
+#define STATS_TIMER_HZ (48000000UL >> STATS_TIMER_PRESCALE_SHIFT)
+
+//Tasks that can be shown in the summary, and named in a trace dump
+//There are 10: the 8 created in main.c, and the idle and timer tasks. The rest is room for more
+//If there are ever more than this, the summary and the dump say so instead of listing them
+#define STATS_MAX_TASKS 16
+
+//Latency histogram. Bins are 2^STATS_LATENCY_BIN_SHIFT stats clock counts wide (~0.68ms)
+//Anything longer than the last bin is counted in it
+#define STATS_LATENCY_BIN_SHIFT 9
+#define STATS_LATENCY_BINS 64
+
+typedef enum
+{
+	STATS_ISR_USB,
+	STATS_ISR_I2C,
+	STATS_ISR_SYSTICK,
+	STATS_NUM_ISRS
+} statsIsr_t;
+
+//Run-time stats clock. Used through portCONFIGURE_TIMER_FOR_RUN_TIME_STATS and portGET_RUN_TIME_COUNTER_VALUE
+void statsTimerInit(void);
+uint32_t statsTimerRead(void);
+
+//Top 16 bits of the stats clock, for code that reads TPM2 itself with interrupts already masked (see traceRecord)
+extern volatile uint32_t statsTimerHigh;
+
+//Time an interrupt handler. Call statsIsrEnter first thing, and pass what it returns to statsIsrExit at the end
+//A nested interrupt's time is also counted in the one it interrupted
+uint32_t statsIsrEnter(void);
+void statsIsrExit(statsIsr_t isr, uint32_t start);
+
+//Print CPU load per task and per interrupt since the last call, in tenths of a percent. One line
+void statsReport(void);
+
+//Record the time from a sample being taken to the host reading the report it is in, in stats clock counts
+//Called from the USB interrupt
+void statsLatencyRecord(uint32_t counts);
+//Print min/avg/p99/max latency in us since the last call, and start again. One line
+void statsLatencyReport(void);
+
+#endif
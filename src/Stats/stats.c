@@ -0,0 +1,223 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+#include <stdint.h>
+#include <MKL46Z4.H>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "debug.h"
+#include "stats.h"
+#include "log.h"
+
+//In port.c
+void xPortSysTickHandler(void);
+
+//Top 16 bits of the run-time stats clock, counted by the TPM2 overflow interrupt
+volatile uint32_t statsTimerHigh = 0;
+
+//Time spent in each timed interrupt, in stats clock counts
+static volatile uint32_t isrTime[STATS_NUM_ISRS];
+
+static const char * const isrNames[STATS_NUM_ISRS] = {"USB", "I2C", "Tick"};
+
+//Sample to wire latency since the last report
+static struct
+{
+	uint16_t bins[STATS_LATENCY_BINS];
+	uint32_t count;
+	uint32_t sum;
+	uint32_t min;
+	uint32_t max;
+} latency = { {0}, 0, 0, UINT32_MAX, 0};
+
+void statsTimerInit(void)
+{
+	SIM->SCGC6 |= SIM_SCGC6_TPM2_MASK;
+	SIM->SOPT2 = (SIM->SOPT2 & ~SIM_SOPT2_TPMSRC_MASK) | SIM_SOPT2_TPMSRC(1); //MCGPLLCLK/2, as PLLFLLSEL selects the PLL
+	
+	TPM2->SC = 0;
+	TPM2->CNT = 0;
+	TPM2->MOD = 0xFFFF;
+	TPM2->SC = TPM_SC_TOF_MASK | TPM_SC_TOIE_MASK | TPM_SC_PS(STATS_TIMER_PRESCALE_SHIFT) | TPM_SC_CMOD(1);
+	
+	NVIC_ClearPendingIRQ(TPM2_IRQn);
+	NVIC_EnableIRQ(TPM2_IRQn);
+}
+
+uint32_t statsTimerRead(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	uint32_t high = statsTimerHigh;
+	uint32_t low = TPM2->CNT;
+	//The counter has wrapped, but the interrupt hasn't counted it yet
+	if((TPM2->SC & TPM_SC_TOF_MASK) && low < 0x8000)
+	{
+		high++;
+	}
+	
+	__set_PRIMASK(primask);
+	return (high << 16) | low;
+}
+
+void TPM2_IRQHandler(void)
+{
+	TPM2->SC |= TPM_SC_TOF_MASK; //Write 1 to clear
+	statsTimerHigh++;
+}
+
+uint32_t statsIsrEnter(void)
+{
+	return statsTimerRead();
+}
+
+void statsIsrExit(statsIsr_t isr, uint32_t start)
+{
+	isrTime[isr] += statsTimerRead() - start;
+}
+
+//SysTick is timed here, rather than going straight to the port's handler
+void SysTick_Handler(void)
+{
+	uint32_t start = statsIsrEnter();
+	xPortSysTickHandler();
+	statsIsrExit(STATS_ISR_SYSTICK, start);
+}
+
+//Print one value as tenths of a percent of elapsed
+static void statsPrint(const char *name, uint32_t time, uint32_t elapsed)
+{
+	dbg_puts(" ");
+	dbg_puts(name);
+	dbg_puts(":");
+	dbg_putdec((uint32_t)(((uint64_t)time * 1000) / elapsed));
+}
+
+//Task times are in the run-time stats counter of each task, which includes any interrupts that ran while it was in
+void statsReport(void)
+{
+	static TaskStatus_t status[STATS_MAX_TASKS];
+	//Totals at the last report. Tasks are indexed by task number, which starts at 1
+	static uint32_t lastTaskTime[STATS_MAX_TASKS+1];
+	static uint32_t lastIsrTime[STATS_NUM_ISRS];
+	static uint32_t lastReport = 0;
+	
+	//uxTaskGetSystemState fills in nothing if they don't all fit
+	UBaseType_t tasks = uxTaskGetNumberOfTasks();
+	if(tasks > STATS_MAX_TASKS)
+	{
+		dbg_puts("CPU: ");
+		dbg_putdec(tasks);
+		dbg_puts(" tasks, more than STATS_MAX_TASKS\r\n");
+		return;
+	}
+	
+	uint32_t now;
+	UBaseType_t count = uxTaskGetSystemState(status, STATS_MAX_TASKS, &now);
+	uint32_t elapsed = now - lastReport;
+	if(count == 0 || elapsed == 0)
+	{
+		return;
+	}
+	lastReport = now;
+	
+	dbg_puts("CPU 0.1%:");
+	for(UBaseType_t i=0; i<count; i++)
+	{
+		UBaseType_t n = status[i].xTaskNumber;
+		if(n <= STATS_MAX_TASKS)
+		{
+			statsPrint(status[i].pcTaskName, status[i].ulRunTimeCounter - lastTaskTime[n], elapsed);
+			lastTaskTime[n] = status[i].ulRunTimeCounter;
+		}
+	}
+	
+	dbg_puts(" | ISR");
+	for(int i=0; i<STATS_NUM_ISRS; i++)
+	{
+		uint32_t total = isrTime[i];
+		statsPrint(isrNames[i], total - lastIsrTime[i], elapsed);
+		lastIsrTime[i] = total;
+	}
+	dbg_puts("\r\n");
+}
+
+void statsLatencyRecord(uint32_t counts)
+{
+	uint32_t bin = counts >> STATS_LATENCY_BIN_SHIFT;
+	if(bin >= STATS_LATENCY_BINS)
+	{
+		bin = STATS_LATENCY_BINS-1;
+	}
+	
+	if(latency.bins[bin] < UINT16_MAX)
+	{
+		latency.bins[bin]++;
+	}
+	latency.count++;
+	latency.sum += counts;
+	if(counts < latency.min)
+	{
+		latency.min = counts;
+	}
+	if(counts > latency.max)
+	{
+		latency.max = counts;
+	}
+}
+
+//Stats clock counts to us. 750kHz, so 4/3us per count
+static uint32_t statsCountsToUs(uint32_t counts)
+{
+	return (counts * 4) / 3;
+}
+
+void statsLatencyReport(void)
+{
+	static uint16_t bins[STATS_LATENCY_BINS];
+	uint32_t count, sum, min, max;
+	
+	//Take a copy and start again. The USB interrupt adds to it
+	taskENTER_CRITICAL();
+	for(int i=0; i<STATS_LATENCY_BINS; i++)
+	{
+		bins[i] = latency.bins[i];
+		latency.bins[i] = 0;
+	}
+	count = latency.count;
+	sum = latency.sum;
+	min = latency.min;
+	max = latency.max;
+	latency.count = 0;
+	latency.sum = 0;
+	latency.min = UINT32_MAX;
+	latency.max = 0;
+	taskEXIT_CRITICAL();
+	
+	if(count == 0)
+	{
+		return;
+	}
+	
+	//p99 is the top of the bin holding the 99th percentile, so it is a slight overestimate
+	uint32_t target = count - count/100;
+	uint32_t seen = 0;
+	uint32_t p99 = max;
+	for(int i=0; i<STATS_LATENCY_BINS-1; i++)
+	{
+		seen += bins[i];
+		if(seen >= target)
+		{
+			p99 = (uint32_t)(i+1) << STATS_LATENCY_BIN_SHIFT;
+			break;
+		}
+	}
+	if(p99 > max)
+	{
+		p99 = max;
+	}
+	
+	LOG_MSG(LOG_LATENCY, count, statsCountsToUs(min), statsCountsToUs(sum / count), statsCountsToUs(p99), statsCountsToUs(max));
+}
@@ -0,0 +1,39 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Sensor telemetry stream, for tuning the filter and ballistics offline
+//When enabled, every touch and accelerometer sample is sent over the UART as a binary packet (see frame.h) with the payload:
+//  sequence number, 32 bit stats clock timestamp, 16 bit channels. Little endian
+//The sequence number counts every packet, so gaps show where packets were dropped
+//tools/telemetry_capture.py decodes the stream and writes a trace file
+//Both streams take about 17kB/s, so the UART must run at 230400 baud or faster
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "frame.h"
+
+//Most channels in one packet
+#define TELEMETRY_MAX_CHANNELS 4
+
+//Packet types, and the channels each carries
+typedef enum
+{
+	TELEMETRY_TOUCH = FRAME_TELEMETRY_TOUCH, //Raw count, moving average
+	TELEMETRY_ACCEL = FRAME_TELEMETRY_ACCEL //Raw x, raw y, ballistics velocity x, ballistics velocity y
+} telemetryType_t;
+
+//Start or stop the stream. Off at reset
+void telemetrySetEnabled(bool enabled);
+bool telemetryEnabled(void);
+
+//Send one sample, if the stream is enabled. count is clamped to TELEMETRY_MAX_CHANNELS
+//Safe from any task. Dropped and counted in telemetryDropped if the UART buffer is full
+void telemetrySend(telemetryType_t type, const int16_t *channels, uint8_t count);
+
+//Number of packets dropped because the UART buffer was full
+extern volatile uint32_t telemetryDropped;
+
+#endif
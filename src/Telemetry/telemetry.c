@@ -0,0 +1,66 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <MKL46Z4.H>
+#include "stats.h"
+#include "frame.h"
+#include "telemetry.h"
+
+//Sequence, timestamp, channels
+#define TELEMETRY_PAYLOAD_SIZE (1 + 4 + TELEMETRY_MAX_CHANNELS*2)
+
+static volatile bool enabled = false;
+static volatile uint8_t sequence = 0;
+
+volatile uint32_t telemetryDropped = 0;
+
+void telemetrySetEnabled(bool enable)
+{
+	enabled = enable;
+}
+
+bool telemetryEnabled(void)
+{
+	return enabled;
+}
+
+void telemetrySend(telemetryType_t type, const int16_t *channels, uint8_t count)
+{
+	if(!enabled)
+	{
+		return;
+	}
+	
+	uint8_t payload[TELEMETRY_PAYLOAD_SIZE];
+	uint8_t *p = payload;
+	uint32_t time = statsTimerRead();
+	
+	if(count > TELEMETRY_MAX_CHANNELS)
+	{
+		count = TELEMETRY_MAX_CHANNELS;
+	}
+	
+	//Several tasks send, so take the sequence number with interrupts off
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint8_t seq = sequence++;
+	__set_PRIMASK(primask);
+	
+	*p++ = seq;
+	for(int i=0; i<4; i++)
+	{
+		*p++ = (uint8_t)(time >> (i*8));
+	}
+	for(uint8_t i=0; i<count; i++)
+	{
+		*p++ = (uint8_t)channels[i];
+		*p++ = (uint8_t)((uint16_t)channels[i] >> 8);
+	}
+	if(!frameSend((frameType_t)type, payload, p - payload))
+	{
+		telemetryDropped++;
+	}
+}
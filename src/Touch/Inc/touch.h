@@ -8,6 +8,7 @@
 #define TOUCH_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 //Electrode 1 is at PTA1
 #define ELEC1_PORT PORTA
@@ -21,7 +22,14 @@
 #define ELEC2_PIN 1
 #define ELEC2_CHANNEL 10
 
+//Call after kvstoreInit, as the calibration is kept in flash
 void touch_init(void);
+
+//Take a new calibration reading, and save it. Nothing must be touching the strip
+//Call from a task. Waits for the touch task to take the reading
+//Returns false if it couldn't be saved. The new reading is used anyway
+bool touch_calibrate(void);
+
 uint16_t touch_read(void);
 
 #endif
@@ -6,10 +6,17 @@
 
 #include "touch.h"
 #include "gpio.h"
+#include "trace.h"
+#include "kvstore.h"
+#include "FreeRTOS.h"
+#include "task.h"
 #include <MKL46Z4.H>
 
 static uint16_t calibrationValue =0;
 
+//Set to have the next reading taken as the calibration. Cleared when it has been
+static volatile bool calibrationRequested = false;
+
 void touch_init(void)
 {
 	//Init pins
@@ -37,14 +44,37 @@ void touch_init(void)
 	//Set measured channel
 	TSI0->DATA = TSI_DATA_TSICH(ELEC1_CHANNEL);
 	
-	//Calibrate module
-	//(assume nobody is touching the moudle at init)
-	calibrationValue = touch_read();
+	//Use the calibration saved in flash, so the strip can be touched at boot and the first reading is valid straight away
+	//Only calibrate if there isn't one
+	int32_t saved;
+	if(kvstoreGet(KV_KEY_TOUCH_CAL, &saved))
+	{
+		calibrationValue = (uint16_t)saved;
+	} else {
+		//Calibrate module
+		//(assume nobody is touching the moudle at init)
+		calibrationRequested = true;
+		touch_read();
+		kvstoreSet(KV_KEY_TOUCH_CAL, calibrationValue);
+	}
+}
+
+bool touch_calibrate(void)
+{
+	//The touch task is reading the strip all the time, so have it take the reading rather than racing it for the TSI
+	calibrationRequested = true;
+	while(calibrationRequested)
+	{
+		vTaskDelay(1);
+	}
+	return kvstoreSet(KV_KEY_TOUCH_CAL, calibrationValue);
 }
 
 uint16_t touch_read(void)
 {
 	//Start software triggered measurement
+	//The TSI is polled rather than interrupt driven, so the trace shows the whole wait
+	traceRecord(TRACE_TSI_START, 0, 0);
 	TSI0->DATA |= TSI_DATA_SWTS_MASK;
 	
 	//Wait for measurement to complete
@@ -55,6 +85,13 @@ uint16_t touch_read(void)
 	
 	//Clear measurement complete flag
 	TSI0->GENCS &= ~TSI_GENCS_EOSF_MASK;
+	traceRecord(TRACE_TSI_END, 0, data);
+	
+	if(calibrationRequested)
+	{
+		calibrationValue = data;
+		calibrationRequested = false;
+	}
 	
 	//Return calibrated data
 	//Or 0 if we are less than the calibration for some reason
@@ -0,0 +1,71 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Binary event trace
+//Events are written to a RAM ring buffer, with a stats clock timestamp, so recording doesn't touch the UART or change timing
+//The kernel records through the FreeRTOS trace macros (see the end of FreeRTOSConfig.h). Interrupts and drivers call traceRecord
+//traceDump prints the buffer over the UART, and tools/trace_decode.py turns that into a timeline
+//Included from FreeRTOSConfig.h, so it must only use standard headers
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+//Set to 0 to compile all tracing out
+#define TRACE_ENABLE 1
+
+//Number of records kept. Must be a power of 2. Each record is 8 bytes
+#define TRACE_BUFFER_SIZE 256
+
+//Event types. The meaning of id and data is given for each
+//Numbers are part of the dump format, so only add to the end
+typedef enum
+{
+	TRACE_TASK_IN = 0, //id: task number
+	TRACE_TASK_OUT, //id: task number
+	TRACE_QUEUE_SEND, //id: queue number, data: queue type. A give for mutexes and semaphores
+	TRACE_QUEUE_RECEIVE, //id: queue number, data: queue type. A take for mutexes and semaphores
+	TRACE_QUEUE_SEND_FROM_ISR, //As TRACE_QUEUE_SEND
+	TRACE_QUEUE_RECEIVE_FROM_ISR, //As TRACE_QUEUE_RECEIVE
+	TRACE_QUEUE_BLOCK_SEND, //As TRACE_QUEUE_SEND. The running task is about to wait for space
+	TRACE_QUEUE_BLOCK_RECEIVE, //As TRACE_QUEUE_RECEIVE. The running task is about to wait for an item or the mutex
+	TRACE_NOTIFY, //id: task number notified, data: low 16 bits of its notification value
+	TRACE_NOTIFY_FROM_ISR, //As TRACE_NOTIFY
+	TRACE_NOTIFY_TAKE, //id: task number taking, data: low 16 bits of its notification value
+	TRACE_NOTIFY_BLOCK, //id: task number about to wait for a notification
+	TRACE_ISR_ENTER, //id: traceIsr_t
+	TRACE_ISR_EXIT, //id: traceIsr_t
+	TRACE_TSI_START, //Touch measurement started
+	TRACE_TSI_END, //data: raw count
+	TRACE_NUM_EVENTS
+} traceEvent_t;
+
+typedef enum
+{
+	TRACE_ISR_USB = 0,
+	TRACE_ISR_I2C
+} traceIsr_t;
+
+#if TRACE_ENABLE
+
+//Start recording. Called by the kernel once the stats clock is running (portCONFIGURE_TIMER_FOR_RUN_TIME_STATS)
+void traceStart(void);
+
+//Add a record. Safe from tasks, interrupts and the kernel, with interrupts masked or not
+//Does nothing while a dump is in progress
+void traceRecord(uint8_t event, uint8_t id, uint16_t data);
+
+//Print every record in the buffer, oldest first, and the task names, then empty it. One record per line
+//Recording is stopped while the dump runs
+void traceDump(void);
+
+#else
+
+#define traceStart()
+#define traceRecord(event, id, data)
+#define traceDump()
+
+#endif
+
+#endif
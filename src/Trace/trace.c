@@ -0,0 +1,152 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <MKL46Z4.H>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "debug.h"
+#include "uart.h"
+#include "stats.h"
+#include "trace.h"
+
+#if TRACE_ENABLE
+
+#define TRACE_BUFFER_MASK (TRACE_BUFFER_SIZE-1)
+
+//Record lines (19 characters) that fit in the UART transmit buffer
+#define TRACE_LINES_PER_FLUSH (UART_TX_BUFFER_SIZE/19)
+
+typedef struct
+{
+	uint32_t time; //Stats clock
+	uint8_t event; //traceEvent_t
+	uint8_t id;
+	uint16_t data;
+} traceEntry_t;
+
+//The index runs freely and is masked on use. Once it passes the size, the oldest records are overwritten
+static traceEntry_t buffer[TRACE_BUFFER_SIZE];
+static uint32_t head = 0;
+//Stopped until the stats clock is running, as TPM2 can't be read before its clock is turned on
+static volatile bool frozen = true;
+
+void traceStart(void)
+{
+	frozen = false;
+}
+
+//statsTimerRead without its own critical section, for use with interrupts already masked
+//The kernel calls traceRecord on every context switch and queue operation, so this saves a call and a second PRIMASK save and restore
+static __inline uint32_t traceTime(void)
+{
+	uint32_t high = statsTimerHigh;
+	uint32_t low = TPM2->CNT;
+	//The counter has wrapped, but the interrupt hasn't counted it yet
+	if((TPM2->SC & TPM_SC_TOF_MASK) && low < 0x8000)
+	{
+		high++;
+	}
+	return (high << 16) | low;
+}
+
+void traceRecord(uint8_t event, uint8_t id, uint16_t data)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	if(!frozen)
+	{
+		traceEntry_t *entry = &buffer[head & TRACE_BUFFER_MASK];
+		entry->time = traceTime();
+		entry->event = event;
+		entry->id = id;
+		entry->data = data;
+		head++;
+	}
+	
+	__set_PRIMASK(primask);
+}
+
+//Write the low digits of val in hex, most significant first
+static char *traceHex(char *p, uint32_t val, uint8_t digits)
+{
+	static const char hex[] = "0123456789abcdef";
+	
+	for(int8_t i=digits-1; i>=0; i--)
+	{
+		*p++ = hex[(val >> (i*4)) & 0xF];
+	}
+	return p;
+}
+
+//Format:
+//TRACE BEGIN <stats clock Hz> <events recorded, including any overwritten>
+//TASK <number> <name>, for every task, or TOO MANY TASKS <count> if there are more than STATS_MAX_TASKS
+//One line per record: 8 hex digits time, 2 event, 2 id, 4 data
+//TRACE END
+void traceDump(void)
+{
+	static TaskStatus_t status[STATS_MAX_TASKS];
+	char line[19]; //16 digits, CR, LF, terminator
+	
+	//Nothing can be added while printing, so head and the buffer stay still
+	frozen = true;
+	
+	uint32_t count = (head < TRACE_BUFFER_SIZE) ? head : TRACE_BUFFER_SIZE;
+	
+	dbg_flush();
+	dbg_puts("TRACE BEGIN ");
+	dbg_putdec(STATS_TIMER_HZ);
+	dbg_puts(" ");
+	dbg_putdec(head);
+	dbg_puts("\r\n");
+	
+	//uxTaskGetSystemState fills in nothing if they don't all fit, so say why the names are missing
+	UBaseType_t tasks = uxTaskGetNumberOfTasks();
+	if(tasks > STATS_MAX_TASKS)
+	{
+		dbg_puts("TOO MANY TASKS ");
+		dbg_putdec(tasks);
+		dbg_puts("\r\n");
+	}
+	tasks = uxTaskGetSystemState(status, STATS_MAX_TASKS, NULL);
+	for(UBaseType_t i=0; i<tasks; i++)
+	{
+		dbg_puts("TASK ");
+		dbg_putdec(status[i].xTaskNumber);
+		dbg_puts(" ");
+		dbg_puts(status[i].pcTaskName);
+		dbg_puts("\r\n");
+	}
+	
+	for(uint32_t i=head-count; i!=head; i++)
+	{
+		//The dump is much bigger than the UART buffer, so let it empty every few lines
+		if(((i - (head-count)) % TRACE_LINES_PER_FLUSH) == 0)
+		{
+			dbg_flush();
+		}
+		
+		const traceEntry_t *entry = &buffer[i & TRACE_BUFFER_MASK];
+		char *p = line;
+		p = traceHex(p, entry->time, 8);
+		p = traceHex(p, entry->event, 2);
+		p = traceHex(p, entry->id, 2);
+		p = traceHex(p, entry->data, 4);
+		*p++ = '\r';
+		*p++ = '\n';
+		*p = '\0';
+		dbg_puts(line);
+	}
+	
+	dbg_puts("TRACE END\r\n");
+	
+	//Start again, so the next dump only covers what happened after this one
+	head = 0;
+	frozen = false;
+}
+
+#endif
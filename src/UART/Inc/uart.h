@@ -2,23 +2,74 @@
 //Licensed under the MIT license
 //See LICENSE.txt
 
-// Basic polling driver for Freescale KL46 family microcontroller
-// The driver is FreeRTOS aware, and only allows one device access at a time.
-// This driver is TX only for now
+// Basic driver for Freescale KL46 family microcontroller
+// Transmit is buffered and interrupt driven. Writes can be made from any task or interrupt, and return straight away
+// If the buffer is full the write is dropped and counted, rather than waiting
+// Receive is interrupt driven. Characters are buffered, and a task can be notified when they arrive
 
 #ifndef UART_H
 #define UART_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
+//Size of the transmit buffer. Must be a power of 2
+#define UART_TX_BUFFER_SIZE 256
+
+//Size of the receive buffer. Must be a power of 2, and no more than 128
+#define UART_RX_BUFFER_SIZE 64
+
+//Range of the oversampling ratio, and largest baud rate divisor
+#define UART_OSR_MIN 4
+#define UART_OSR_MAX 32
+#define UART_SBR_MAX 8191
+
 //Setup UART 0
-void uart_init(int baud);
+//Any rate from the UART clock / (32*8191) (183baud) up to the UART clock / 4 (12Mbaud) can be asked for
+//The closest that can be made is used, and returned. Rates outside that range, including 0, are clamped to it
+uint32_t uart_init(uint32_t baud);
+
+//Baud rate set by uart_init, and its error from the rate asked for in parts per million
+uint32_t uart_baud(void);
+int32_t uart_baud_error_ppm(void);
 
-//Send char from UART 0
+//Queue char to send from UART 0
 void uart_putchar(char c);
 
-//Send string from UART 0
+//Get a received char from UART 0 without waiting. -1 if there is none
+//Only one task should read
+int uart_getchar(void);
+
+//Give the task that reads, to have it notified (as by xTaskNotifyGive) for each char received
+//task is a TaskHandle_t. This header is included by FreeRTOSConfig.h (through debug.h), so it can't include task.h
+void uart_rx_notify(void *task);
+
+//Queue string to send from UART 0
+//The whole string is sent or dropped, so it is never split or mixed with other writes
+//A string longer than UART_TX_BUFFER_SIZE is always dropped
 void uart_puts(const char *str);
 
-//Internal function to calculate error between transmit baud rate and ideal baud rate
-static int calcBaudError(int clk, int sbr, int osr, int baud);
+//Queue len bytes of binary data to send from UART 0
+//Like uart_puts, it is all sent or all dropped. Returns false if it was dropped
+bool uart_write(const void *data, uint16_t len);
+
+//Wait until everything queued has been sent. Only call from a task
+//For output longer than the buffer
+void uart_flush(void);
+
+//Queue unsigned number to send in decimal from UART 0
+void uart_putdec(uint32_t val);
+
+//Send a string, or a number in decimal, by polling the UART, for fault and assert messages
+//Anything already queued is sent first. Interrupts are masked throughout and it returns once the last bit is out,
+//so it works from fault handlers and with interrupts disabled. It waits for the UART, so don't use it otherwise
+void uart_puts_polled(const char *str);
+void uart_putdec_polled(uint32_t val);
+
+//Number of characters dropped because the transmit buffer was full, or the string was too long for it
+extern volatile uint32_t uartDropped;
+
+//Number of characters lost on receive, because the buffer was full or the UART overran
+extern volatile uint32_t uartRxDropped;
 
 #endif
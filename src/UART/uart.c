@@ -2,33 +2,64 @@
 //Licensed under the MIT license
 //See LICENSE.txt
 
-// Basic polling driver for Freescale KL46 family microcontroller
-// This driver is TX only for now
+// Basic driver for Freescale KL46 family microcontroller
+// Transmit is buffered and interrupt driven, so writes never wait for the UART
+// Receive is interrupt driven too, into a small buffer that a task reads
 
 // We want the UART which is routed through the SDA MCU on the FRDM-KL46Z
 // This is PTA1 (UART0_RX) and PTA2 (UART0_TX) (FRDM-KL46Z user manual p.10)
 
 #include <MKL46Z4.H> //For device registers
-#include <stdlib.h> //For abs()
 #include <stdbool.h> //For boolean type
+#include <string.h> //For strlen
 #include "uart.h"
 
-//Include FreeRTOS type for semaphopre handlig
+//FreeRTOS, for waiting in uart_flush and waking the receiving task
 #include "FreeRTOS.h"
-#include "semphr.h"
+#include "task.h"
 
-//Sempahore to only allow one person to use the UART at once
-static xSemaphoreHandle uartGatekeeper =0;
+#define UART_TX_BUFFER_MASK (UART_TX_BUFFER_SIZE-1)
 
-//Flag to signal if internal function has gatekeeper
-//This means that uart_puts can take the gatekeeper, and uart_putchar will still write
-static bool internalHasGatekeeper = false;
+//Transmit ring buffer, drained by UART0_IRQHandler
+//A writer reserves its space with interrupts masked, copies into it with them on, then masks them again to publish it
+//Tasks and interrupts can all write, and a string is never split up
+//The interrupt only sends up to txHead. That is moved up to txReserve when the last writer copying finishes,
+//so a writer that is interrupted holds back anything written after it until it is done
+//Only the interrupt moves the tail. The indices run freely and are masked on use
+static volatile uint8_t txBuffer[UART_TX_BUFFER_SIZE];
+static volatile uint16_t txHead = 0;
+static volatile uint16_t txReserve = 0;
+static volatile uint16_t txTail = 0;
+static volatile uint8_t txWriters = 0;
+
+volatile uint32_t uartDropped = 0;
+
+//Receive ring buffer, filled by UART0_IRQHandler. Only the interrupt moves the head, only uart_getchar moves the tail
+#define UART_RX_BUFFER_MASK (UART_RX_BUFFER_SIZE-1)
+static volatile uint8_t rxBuffer[UART_RX_BUFFER_SIZE];
+static volatile uint8_t rxHead = 0;
+static volatile uint8_t rxTail = 0;
+
+volatile uint32_t uartRxDropped = 0;
+
+//Task to notify when a character arrives
+static TaskHandle_t rxTask = NULL;
+
+//Baud rate set by uart_init
+static uint32_t achievedBaud = 0;
+static int32_t baudErrorPpm = 0;
+
+//Calculate the error between the baud rate the chosen sbr and osr will produce and the one wanted
+static uint32_t calcBaudError(uint32_t clk, uint32_t sbr, uint32_t osr, uint32_t baud);
 
 //Setup UART 0
-//Argument is baud rate
-void uart_init(int baud)
+//Argument is baud rate. Returns the rate actually set
+uint32_t uart_init(uint32_t baud)
 {
-	uint16_t sbr; //Baud rate module divisor
+	uint32_t clk = SystemCoreClock; //UART0 runs from MCGPLLCLK/2, equal to the system clock in our system
+	uint32_t sbr = 1; //Baud rate module divisor
+	uint32_t osr = 16; //Oversampling ratio
+	uint32_t bestError = UINT32_MAX;
 	
 	//Setup SIM (System Integration Module)
 	SIM->SOPT2 |=  SIM_SOPT2_UART0SRC(1); //Set UART to use MCGPLLCLK/2 (Equal to system clock in our system)
@@ -40,23 +71,49 @@ void uart_init(int baud)
 	PORTA->PCR[2] = PORT_PCR_MUX(1u<<1); //Set Mux control to 010. Alt 2 (UART0_TX)
 	PTA->PDDR |= (1u<<2); //Set PTA2 (UART0_TX) as output
 	
+	//The fastest rate is with the smallest OSR and SBR, and the slowest with the largest
+	//Below that, including 0, which the divides below can't take, the slowest is used
+	if(baud > clk/UART_OSR_MIN)
+	{
+		baud = clk/UART_OSR_MIN;
+	}
+	if(baud < clk/(UART_OSR_MAX*UART_SBR_MAX))
+	{
+		baud = clk/(UART_OSR_MAX*UART_SBR_MAX);
+	}
 	
-	//Divisor = (module_clock)/(baud_rate * (OSR+1))
-	//From reference manual p.762
-	//However this gives wrong result!
-	//Example code uses formula:
-	//Divisor = (module_clock)/(baud_rate * (OSR))
-	//This works...
-	//Default OSR (Oversampling rate) is 16
-	sbr = (SystemCoreClock/(baud * 16));
-	
-	//Due to integer division errors, pick the best of sbr and sbr+1
-	if (calcBaudError(SystemCoreClock,sbr+1, 16, 115200) < calcBaudError(SystemCoreClock,sbr, 16, 115200))
+	//Baud rate = module_clock / (SBR * OSR)
+	//(The reference manual p.762 says OSR+1, but the register holds OSR-1, so it is the same thing)
+	//Try every OSR with the nearest SBR, and keep the closest
+	//Highest OSR first, so if two are as good the one with more samples per bit wins
+	for(uint32_t tryOsr = UART_OSR_MAX; tryOsr >= UART_OSR_MIN; tryOsr--)
 	{
-		sbr = sbr+1;
+		uint32_t trySbr = (clk + (baud*tryOsr)/2) / (baud*tryOsr);
+		if(trySbr < 1)
+		{
+			trySbr = 1;
+		}
+		if(trySbr > UART_SBR_MAX)
+		{
+			trySbr = UART_SBR_MAX;
+		}
+		
+		uint32_t error = calcBaudError(clk, trySbr, tryOsr, baud);
+		if(error < bestError)
+		{
+			bestError = error;
+			sbr = trySbr;
+			osr = tryOsr;
+		}
 	}
 	
+	achievedBaud = (clk + (sbr*osr)/2) / (sbr*osr);
+	baudErrorPpm = (int32_t)(((int64_t)achievedBaud - (int64_t)baud) * 1000000 / (int64_t)baud);
+	
 	// Setup UART Peripheral
+	// The baud rate can only be changed with the transmitter and receiver off
+	UART0->C2 = 0;
+	
 	// Lower nibble of BDH is upper 4 bits of BMD
 	// We want other settings to be 0
 	UART0->BDH = (uint8_t) ((sbr >> 8) & 0x1F);
@@ -64,58 +121,252 @@ void uart_init(int baud)
 	// BDL is lower 8 bits of bmd
 	UART0->BDL = (uint8_t) (sbr & 0xFF);
 	
-	//Enable transmitter and receiver
-	UART0->C2 |= (UART0_C2_TE_MASK | UART0_C2_RE_MASK);
+	// C4 holds OSR-1. Below 8x oversampling, the receiver must sample on both clock edges
+	UART0->C4 = (UART0->C4 & ~UART0_C4_OSR_MASK) | UART0_C4_OSR(osr-1);
+	if(osr < 8)
+	{
+		UART0->C5 |= UART0_C5_BOTHEDGE_MASK;
+	} else {
+		UART0->C5 &= ~UART0_C5_BOTHEDGE_MASK;
+	}
+	
+	//Enable transmitter and receiver, and the receive interrupt
+	//The transmit interrupt is turned on when there is something to send
+	UART0->C2 |= (UART0_C2_TE_MASK | UART0_C2_RE_MASK | UART0_C2_RIE_MASK);
 	
-	//Create gatekeepter
-	uartGatekeeper = xSemaphoreCreateMutex();
+	//The interrupt notifies the receiving task, so it must be at an API safe level
+	NVIC_SetPriority(UART0_IRQn, configMAX_API_CALL_INTERRUPT_PRIORITY);
+	NVIC_ClearPendingIRQ(UART0_IRQn);
+	NVIC_EnableIRQ(UART0_IRQn);
 	
+	return achievedBaud;
 }
 
-//Send a character via the UART
-void uart_putchar(char c)
+uint32_t uart_baud(void)
+{
+	return achievedBaud;
+}
+
+int32_t uart_baud_error_ppm(void)
 {
-	//Take and return the gatekeeper if not called internally
-	if(!internalHasGatekeeper)
+	return baudErrorPpm;
+}
+
+//Count bytes dropped. uartDropped is written by tasks and interrupts, so it is only changed with interrupts masked
+static void countDropped(uint32_t len)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uartDropped += len;
+	__set_PRIMASK(primask);
+}
+
+//Copy len bytes into the transmit buffer and start the interrupt
+//All or nothing, so a line is never cut short. Anything that doesn't fit is counted in uartDropped
+//Interrupts are only masked to reserve and publish the space, not for the copy, so that time doesn't grow with len
+//Returns false if it was dropped
+bool uart_write(const void *data, uint16_t len)
+{
+	const uint8_t *bytes = data;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	uint16_t start = txReserve;
+	if((uint16_t)(UART_TX_BUFFER_SIZE - (uint16_t)(start - txTail)) < len)
 	{
-		//No need to wrap this in an if, as we will wait forever to get the gatekeeper
-		xSemaphoreTake(uartGatekeeper, portMAX_DELAY);
+		uartDropped += len;
+		__set_PRIMASK(primask);
+		return false;
 	}
+	txReserve = start + len;
+	txWriters++;
 	
-	//Wait until there is room in the transmit buffer
-	while(!(UART0->S1 & UART0_S1_TDRE_MASK));
+	__set_PRIMASK(primask);
+	
+	for(uint16_t i=0; i<len; i++)
+	{
+		txBuffer[(start + i) & UART_TX_BUFFER_MASK] = bytes[i];
+	}
 	
-	//Put data into UART data register for transmission
-	UART0->D = (uint8_t) c;
+	__disable_irq();
 	
-	if(!internalHasGatekeeper)
+	//Publish once nobody is still copying, which covers any writes that came in while this one was
+	if(--txWriters == 0)
 	{
-		xSemaphoreGive(uartGatekeeper);
+		txHead = txReserve;
+		UART0->C2 |= UART0_C2_TIE_MASK;
 	}
+	
+	__set_PRIMASK(primask);
+	return true;
+}
+
+//Queue a character to send via the UART
+void uart_putchar(char c)
+{
+	uart_write(&c, 1);
+}
+
+//Get a received character without waiting
+//Returns -1 if nothing has arrived
+int uart_getchar(void)
+{
+	uint8_t tail = rxTail;
+	
+	if(tail == rxHead)
+	{
+		return -1;
+	}
+	
+	//Don't read the entry before seeing the head that covers it
+	__DMB();
+	int c = rxBuffer[tail & UART_RX_BUFFER_MASK];
+	__DMB();
+	rxTail = tail + 1;
+	return c;
+}
 
+void uart_rx_notify(void *task)
+{
+	rxTask = (TaskHandle_t)task;
 }
 
-//Send a string via the UART
+//Queue a string to send via the UART
+//A string too long for the buffer could never be sent whole, so it is dropped and counted like any other that doesn't fit
 void uart_puts(const char *str)
 {
-	if(xSemaphoreTake(uartGatekeeper, portMAX_DELAY))
+	size_t len = strlen(str);
+	
+	if(len > UART_TX_BUFFER_SIZE)
+	{
+		countDropped(len);
+		return;
+	}
+	uart_write(str, (uint16_t)len);
+}
+
+//Wait until everything queued has been sent. Sleeps a tick at a time, so only call from a task
+void uart_flush(void)
+{
+	while(txReserve != txTail)
+	{
+		vTaskDelay(1);
+	}
+}
+
+//Send a character once the data register is empty, without the interrupt. Interrupts must be masked
+static void putcharPolled(uint8_t c)
+{
+	while(!(UART0->S1 & UART0_S1_TDRE_MASK));
+	UART0->D = c;
+}
+
+//Send what is queued, then the string, by polling
+//The transmit interrupt is masked with everything else, so it can't take characters from under us
+void uart_puts_polled(const char *str)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	while(txTail != txHead)
+	{
+		putcharPolled(txBuffer[txTail & UART_TX_BUFFER_MASK]);
+		txTail = txTail + 1;
+	}
+	UART0->C2 &= ~UART0_C2_TIE_MASK;
+	
+	while(*str)
 	{
-		//Signal that an internal function has the gatekeeper, sot that uart_putchar won't block us
-		internalHasGatekeeper = true;
-		while(*str)
+		putcharPolled(*str++);
+	}
+	
+	//Wait for the last character to leave the shift register
+	while(!(UART0->S1 & UART0_S1_TC_MASK));
+	
+	__set_PRIMASK(primask);
+}
+
+//Store each character received, and send the next character whenever the data register is empty, until the buffer is empty
+void UART0_IRQHandler(void)
+{
+	BaseType_t woken = pdFALSE;
+	uint8_t status = UART0->S1;
+	
+	//An overrun stops the receiver until the flag is cleared (write 1 to clear)
+	//The character already in the data register is still good
+	if(status & UART0_S1_OR_MASK)
+	{
+		UART0->S1 = UART0_S1_OR_MASK;
+		uartRxDropped++;
+	}
+	
+	if(status & UART0_S1_RDRF_MASK)
+	{
+		uint8_t c = UART0->D;
+		uint8_t head = rxHead;
+		if((uint8_t)(head - rxTail) >= UART_RX_BUFFER_SIZE)
+		{
+			uartRxDropped++;
+		} else {
+			rxBuffer[head & UART_RX_BUFFER_MASK] = c;
+			//The entry must be written before the reader can see it
+			__DMB();
+			rxHead = head + 1;
+		}
+		
+		if(rxTask != NULL)
 		{
-			uart_putchar(*str);
-			
-			str++;
+			vTaskNotifyGiveFromISR(rxTask, &woken);
 		}
-		internalHasGatekeeper = false;
-		xSemaphoreGive(uartGatekeeper);
 	}
+	
+	if((UART0->C2 & UART0_C2_TIE_MASK) && (status & UART0_S1_TDRE_MASK))
+	{
+		uint16_t tail = txTail;
+		if(tail == txHead)
+		{
+			UART0->C2 &= ~UART0_C2_TIE_MASK;
+		} else {
+			UART0->D = txBuffer[tail & UART_TX_BUFFER_MASK];
+			txTail = tail + 1;
+		}
+	}
+	
+	portEND_SWITCHING_ISR(woken);
+}
+
+//Write an unsigned number in decimal to the end of buf, which must hold 11 chars
+//Returns where it starts
+static char *formatDec(char *buf, uint32_t val)
+{
+	char *p = &buf[10];
+	
+	*p = '\0';
+	do
+	{
+		*--p = '0' + (val % 10);
+		val /= 10;
+	} while(val);
+	
+	return p;
+}
+
+//Send an unsigned number in decimal via the UART
+void uart_putdec(uint32_t val)
+{
+	char buf[11]; //Enough for 4294967295 and the terminator
+	uart_puts(formatDec(buf, val));
+}
+
+void uart_putdec_polled(uint32_t val)
+{
+	char buf[11];
+	uart_puts_polled(formatDec(buf, val));
 }
 
-//Calculate the baud rate the chosen sbr will produce
-static int calcBaudError(int clk, int sbr, int osr, int baud)
+static uint32_t calcBaudError(uint32_t clk, uint32_t sbr, uint32_t osr, uint32_t baud)
 {
-	int calcBaud = clk/(sbr*osr);
-	return abs(calcBaud - baud);
+	uint32_t calcBaud = (clk + (sbr*osr)/2) / (sbr*osr);
+	return (calcBaud > baud) ? (calcBaud - baud) : (baud - calcBaud);
 }
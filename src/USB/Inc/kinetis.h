@@ -12,6 +12,7 @@
 
 #define IRQ_USBOTG USB0_IRQn
 #define NVIC_ENABLE_IRQ NVIC_EnableIRQ
+#define NVIC_DISABLE_IRQ NVIC_DisableIRQ
 #define NVIC_SET_PRIORITY NVIC_SetPriority
 
 #undef USB_ENDPT_EPSTALL
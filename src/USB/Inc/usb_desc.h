@@ -61,13 +61,18 @@
   #define PRODUCT_NAME_LEN	5
   #define EP0_SIZE		64
   #define NUM_ENDPOINTS		1
-  #define NUM_USB_BUFFERS	30
   #define NUM_INTERFACE		1
   #define MOUSE_INTERFACE       3	// Mouse
   #define MOUSE_ENDPOINT        1
-  #define MOUSE_SIZE            8
+  #define MOUSE_SIZE            16	// Largest report is the 9 byte 16-bit relative report (ID 3)
   #define MOUSE_INTERVAL        2
+  #define MOUSE_BUFFERS         4	// 2 owned by the BDT, 1 queued, 1 being filled
   #define ENDPOINT1_CONFIG	ENDPOINT_TRANSIMIT_ONLY
+  #define ENDPOINT1_SIZE	MOUSE_SIZE
+  #define ENDPOINT1_BUFFERS	MOUSE_BUFFERS
+  // Upper limit on packet pool RAM, checked at build time in usb_mem.c
+  // EP0 doesn't count here as it uses its own EP0_SIZE buffers in usb_dev.c
+  #define USB_BUFFER_RAM_BUDGET	256
 
 
 #ifdef USB_DESC_LIST_DEFINE
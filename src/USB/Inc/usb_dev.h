@@ -35,11 +35,14 @@
 
 #include "usb_desc.h"
 #include "usb_mem.h"
+#include "FreeRTOS.h"
+#include "task.h"
 
 void usb_init(void);
 void usb_init_serialnumber(void);
 void USB0_IRQHandler(void); //Interrupt handler wrapper for CMSIS name
 void usb_isr(void); //Actual ISR
+void usb_task(void *pvParameters); //Handles control requests deferred from the ISR
 usb_packet_t *usb_rx(uint32_t endpoint);
 uint32_t usb_tx_byte_count(uint32_t endpoint);
 uint32_t usb_tx_packet_count(uint32_t endpoint);
@@ -47,6 +50,8 @@ void usb_tx(uint32_t endpoint, usb_packet_t *packet);
 void usb_tx_isochronous(uint32_t endpoint, void *data, uint32_t len);
 
 extern volatile uint8_t usb_configuration;
+extern volatile uint32_t usb_isr_max_cycles;
+extern TaskHandle_t usb_task_handle; //Set when usb_task is created, so the ISR can notify it
 
 extern uint16_t usb_rx_byte_count_data[NUM_ENDPOINTS];
 static inline uint32_t usb_rx_byte_count(uint32_t endpoint) __attribute__((always_inline));
@@ -32,20 +32,31 @@
 #define _usb_mem_h_
 
 #include <stdint.h>
+#include <stddef.h>
 
+// Packets are allocated from per-endpoint pools (see usb_mem.c), so the
+// payload is sized by the pool rather than fixed here
 typedef struct usb_packet_struct {
 	uint16_t len;
 	uint16_t index;
 	struct usb_packet_struct *next;
-	uint8_t buf[64];
+	uint32_t timestamp; // statsTimerRead() when the data in buf was sampled, for latency. 0 if not tracked
+	uint8_t buf[];
 } usb_packet_t;
 
+// The BDT points at buf, so this is subtracted to get back to the packet
+#define USB_PACKET_HEADER_SIZE	offsetof(usb_packet_t, buf)
+
+// Bytes taken by one packet of the given payload size in a pool
+#define USB_PACKET_STRIDE(size)	(sizeof(usb_packet_t) + (((size) + 3) & ~3))
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-usb_packet_t * usb_malloc(void);
+usb_packet_t * usb_malloc(uint32_t endpoint);
 void usb_free(usb_packet_t *p);
+uint32_t usb_packet_size(uint32_t endpoint);
 
 #ifdef __cplusplus
 }
@@ -40,6 +40,12 @@
 // C language implementation
 uint8_t usb_mouse_buttons(uint8_t left, uint8_t middle, uint8_t right, uint8_t back, uint8_t forward);
 int usb_mouse_send_data(int8_t x, int8_t y, int8_t wheel, int8_t horiz, uint8_t usb_mouse_buttons_state);
+int usb_mouse_send_data16(int16_t x, int16_t y, int16_t wheel, int16_t horiz);
+int usb_mouse_send_absolute(uint16_t x, uint16_t y);
+uint32_t usb_mouse_idle_ms(void);
+void usb_mouse_set_sample_time(uint32_t time);
+
+extern volatile uint8_t usb_mouse_idle_rate;
 
 #define MOUSE_LEFT 1
 #define MOUSE_MIDDLE 4
@@ -48,6 +54,9 @@ int usb_mouse_send_data(int8_t x, int8_t y, int8_t wheel, int8_t horiz, uint8_t
 #define MOUSE_FORWARD 16
 #define MOUSE_ALL (MOUSE_LEFT | MOUSE_RIGHT | MOUSE_MIDDLE | MOUSE_BACK | MOUSE_FORWARD)
 
+// Logical maximum of the absolute X/Y in report ID 2
+#define MOUSE_ABSOLUTE_MAX 32767
+
 #endif // MOUSE_INTERFACE
 
 #endif // USBmouse_h_
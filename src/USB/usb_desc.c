@@ -211,6 +211,27 @@ static uint8_t mouse_report_desc[] = {
         0x75, 0x10,                     //   Report Size (16),
         0x95, 0x02,                     //   Report Count (2),
         0x81, 0x02,                     //   Input (Data, Variable, Absolute)
+        0xC0,                           // End Collection
+        0x05, 0x01,                     // Usage Page (Generic Desktop)
+        0x09, 0x02,                     // Usage (Mouse)
+        0xA1, 0x01,                     // Collection (Application)
+        0x85, 0x03,                     //   REPORT_ID (3)
+        0x05, 0x01,                     //   Usage Page (Generic Desktop)
+        0x09, 0x30,                     //   Usage (X)
+        0x09, 0x31,                     //   Usage (Y)
+        0x09, 0x38,                     //   Usage (Wheel)
+        0x16, 0x01, 0x80,               //   Logical Minimum (-32767)
+        0x26, 0xFF, 0x7F,               //   Logical Maximum (32767)
+        0x75, 0x10,                     //   Report Size (16),
+        0x95, 0x03,                     //   Report Count (3),
+        0x81, 0x06,                     //   Input (Data, Variable, Relative)
+        0x05, 0x0C,                     //   Usage Page (Consumer)
+        0x0A, 0x38, 0x02,               //   Usage (AC Pan)
+        0x16, 0x01, 0x80,               //   Logical Minimum (-32767)
+        0x26, 0xFF, 0x7F,               //   Logical Maximum (32767)
+        0x75, 0x10,                     //   Report Size (16),
+        0x95, 0x01,                     //   Report Count (1),
+        0x81, 0x06,                     //   Input (Data, Variable, Relative)
         0xC0                            // End Collection
 };
 #endif
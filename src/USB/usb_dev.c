@@ -38,11 +38,16 @@
  */
 
 #include "usb_dev.h"
+#include "usb_mouse.h"
 
 #include "kinetis.h"
 #include "usb_mem.h"
 #include <string.h> // for memset
 #include "FreeRTOSConfig.h" //For configMAX_API_CALL_INTERRUPT_PRIORITY definition
+#include "FreeRTOS.h" //For deferring control requests to usb_task
+#include "task.h"
+#include "stats.h" //For timing usb_isr and measuring report latency
+#include "trace.h" //For tracing usb_isr
 
 #pragma anon_unions //Allow anonymous unions
 
@@ -61,6 +66,10 @@ static usb_packet_t *rx_last[NUM_ENDPOINTS];
 static usb_packet_t *tx_first[NUM_ENDPOINTS];
 static usb_packet_t *tx_last[NUM_ENDPOINTS];
 uint16_t usb_rx_byte_count_data[NUM_ENDPOINTS];
+// Running totals for the tx_first queues, so the count queries don't walk the
+// list with interrupts disabled. Updated in usb_tx() and the TOKDNE path.
+static uint16_t usb_tx_byte_count_data[NUM_ENDPOINTS];
+static uint8_t usb_tx_packet_count_data[NUM_ENDPOINTS];
 
 static uint8_t tx_state[NUM_ENDPOINTS];
 #define TX_STATE_BOTH_FREE_EVEN_FIRST	0
@@ -89,6 +98,10 @@ static uint8_t tx_state[NUM_ENDPOINTS];
 #define DATA1 1
 #define index(endpoint, tx, odd) (((endpoint) << 2) | ((tx) << 1) | (odd))
 #define stat2bufferdescriptor(stat) (table + ((stat) >> 2))
+// Odd buffer of its pair. Taken from the index rather than address bit 3, so
+// it doesn't depend on bdt_t being 8 bytes, and the queue code also runs on a
+// 64 bit host (tools/usb_queue_model.c)
+#define bdt_odd(b) (((b) - table) & 1)
 
 
 static union {
@@ -138,6 +151,15 @@ uint8_t usb_rx_memory_needed = 0;
 volatile uint8_t usb_configuration = 0;
 volatile uint8_t usb_reboot_timer = 0;
 
+// Control requests are handed from the ISR to usb_task with a task notification.
+// The SIE is left suspended (TXSUSPENDTOKENBUSY) until usb_task has run usb_setup()
+TaskHandle_t usb_task_handle = NULL;
+static volatile uint8_t usb_setup_pending = 0;
+static BaseType_t usb_task_woken = pdFALSE;
+
+// Longest time spent in usb_isr() since boot, in CPU cycles
+volatile uint32_t usb_isr_max_cycles = 0;
+
 static void endpoint0_stall(void)
 {
 	USB0_ENDPT0 = USB_ENDPT_EPSTALL | USB_ENDPT_EPRXEN | USB_ENDPT_EPTXEN | USB_ENDPT_EPHSHK;
@@ -184,7 +206,7 @@ static void usb_setup(void)
 		// clear all BDT entries, free any allocated memory...
 		for (i=4; i < (NUM_ENDPOINTS+1)*4; i++) {
 			if (table[i].desc & BDT_OWN) {
-				usb_free((usb_packet_t *)((uint8_t *)(table[i].addr) - 8));
+				usb_free((usb_packet_t *)((uint8_t *)(table[i].addr) - USB_PACKET_HEADER_SIZE));
 			}
 		}
 		// free all queued packets
@@ -207,6 +229,8 @@ static void usb_setup(void)
 			tx_first[i] = NULL;
 			tx_last[i] = NULL;
 			usb_rx_byte_count_data[i] = 0;
+			usb_tx_byte_count_data[i] = 0;
+			usb_tx_packet_count_data[i] = 0;
 			switch (tx_state[i]) {
 			  case TX_STATE_EVEN_FREE:
 			  case TX_STATE_NONE_FREE_EVEN_FIRST:
@@ -235,18 +259,18 @@ static void usb_setup(void)
 #endif
 			if (epconf & USB_ENDPT_EPRXEN) {
 				usb_packet_t *p;
-				p = usb_malloc();
+				p = usb_malloc(i);
 				if (p) {
 					table[index(i, RX, EVEN)].addr = p->buf;
-					table[index(i, RX, EVEN)].desc = BDT_DESC(64, 0);
+					table[index(i, RX, EVEN)].desc = BDT_DESC(usb_packet_size(i), 0);
 				} else {
 					table[index(i, RX, EVEN)].desc = 0;
 					usb_rx_memory_needed++;
 				}
-				p = usb_malloc();
+				p = usb_malloc(i);
 				if (p) {
 					table[index(i, RX, ODD)].addr = p->buf;
-					table[index(i, RX, ODD)].desc = BDT_DESC(64, 1);
+					table[index(i, RX, ODD)].desc = BDT_DESC(usb_packet_size(i), 1);
 				} else {
 					table[index(i, RX, ODD)].desc = 0;
 					usb_rx_memory_needed++;
@@ -377,11 +401,34 @@ static void usb_setup(void)
 	  case 0x0921: // HID SET_REPORT
 		//serial_print(":)\n");
 		return;
+#if !defined(MOUSE_INTERFACE)
 	  case 0x0A21: // HID SET_IDLE
 		break;
+#endif
 	  // case 0xC940:
 #endif
 
+#if defined(MOUSE_INTERFACE)
+	  case 0x0A21: // HID SET_IDLE
+		if (setup.wIndex != MOUSE_INTERFACE) {
+			endpoint0_stall();
+			return;
+		}
+		// upper byte is the duration in 4 ms units, lower byte the report ID
+		// the same rate is used for every report ID
+		usb_mouse_idle_rate = setup.wValue >> 8;
+		break;
+	  case 0x02A1: // HID GET_IDLE
+		if (setup.wIndex != MOUSE_INTERFACE) {
+			endpoint0_stall();
+			return;
+		}
+		reply_buffer[0] = usb_mouse_idle_rate;
+		datalen = 1;
+		data = reply_buffer;
+		break;
+#endif
+
 #if defined(AUDIO_INTERFACE)
 	  case 0x0B01: // SET_INTERFACE (alternate setting)
 		if (setup.wIndex == AUDIO_INTERFACE+1) {
@@ -568,11 +615,12 @@ static void usb_control(uint32_t stat)
 		serial_phex16(setup.wLength);
 		serial_print("\n");
 #endif
-		// actually "do" the setup request
-		usb_setup();
-		// unfreeze the USB, now that we're ready
-		USB0_CTL = USB_CTL_USBENSOFEN; // clear TXSUSPENDTOKENBUSY bit
-		break;
+		// actually "do" the setup request, in usb_task
+		// the USB stays frozen until usb_task has handled it
+		usb_setup_pending = 1;
+		// if usb_task doesn't exist yet, it sees usb_setup_pending when it starts
+		if (usb_task_handle) vTaskNotifyGiveFromISR(usb_task_handle, &usb_task_woken);
+		return;
 	case 0x01:  // OUT transaction received from host
 	case 0x02:
 		//serial_print("PID=OUT\n");
@@ -671,18 +719,6 @@ usb_packet_t *usb_rx(uint32_t endpoint)
 	return ret;
 }
 
-static uint32_t usb_queue_byte_count(const usb_packet_t *p)
-{
-	uint32_t count=0;
-
-	__disable_irq();
-	for ( ; p; p = p->next) {
-		count += p->len;
-	}
-	__enable_irq();
-	return count;
-}
-
 // TODO: make this an inline function...
 /*
 uint32_t usb_rx_byte_count(uint32_t endpoint)
@@ -694,24 +730,20 @@ uint32_t usb_rx_byte_count(uint32_t endpoint)
 }
 */
 
+// Both counts are maintained incrementally, so these are a single load
+// and don't need interrupts disabled
 uint32_t usb_tx_byte_count(uint32_t endpoint)
 {
 	endpoint--;
 	if (endpoint >= NUM_ENDPOINTS) return 0;
-	return usb_queue_byte_count(tx_first[endpoint]);
+	return usb_tx_byte_count_data[endpoint];
 }
 
 uint32_t usb_tx_packet_count(uint32_t endpoint)
 {
-	const usb_packet_t *p;
-	uint32_t count=0;
-
 	endpoint--;
 	if (endpoint >= NUM_ENDPOINTS) return 0;
-	__disable_irq();
-	for (p = tx_first[endpoint]; p; p = p->next) count++;
-	__enable_irq();
-	return count;
+	return usb_tx_packet_count_data[endpoint];
 }
 
 
@@ -720,49 +752,44 @@ uint32_t usb_tx_packet_count(uint32_t endpoint)
 // endpoints needing receive memory priority over the user's code, which is
 // likely calling usb_malloc to obtain memory for transmitting.  When the
 // user is creating data very quickly, their consumption could starve reception
-// without this prioritization.  The packet buffer (input) is assigned to the
-// first endpoint needing memory.
+// without this prioritization.  Each endpoint has its own pool, so the packet
+// buffer (input) can only go to the endpoint it was allocated for.
+// Returns 1 if the packet was used, or 0 if it should go back to its pool.
 //
-void usb_rx_memory(usb_packet_t *packet)
+int usb_rx_memory(uint32_t endpoint, usb_packet_t *packet)
 {
-	unsigned int i;
-	const uint8_t *cfg;
+	uint32_t size;
 
-	cfg = usb_endpoint_config_table;
-	//serial_print("rx_mem:");
-	__disable_irq();
-	for (i=1; i <= NUM_ENDPOINTS; i++) {
+	if (endpoint == 0 || endpoint > NUM_ENDPOINTS) return 0;
 #ifdef AUDIO_INTERFACE
-		if (i == AUDIO_RX_ENDPOINT) continue;
+	if (endpoint == AUDIO_RX_ENDPOINT) return 0;
 #endif
-		if (*cfg++ & USB_ENDPT_EPRXEN) {
-			if (table[index(i, RX, EVEN)].desc == 0) {
-				table[index(i, RX, EVEN)].addr = packet->buf;
-				table[index(i, RX, EVEN)].desc = BDT_DESC(64, 0);
-				usb_rx_memory_needed--;
-				__enable_irq();
-				//serial_phex(i);
-				//serial_print(",even\n");
-				return;
-			}
-			if (table[index(i, RX, ODD)].desc == 0) {
-				table[index(i, RX, ODD)].addr = packet->buf;
-				table[index(i, RX, ODD)].desc = BDT_DESC(64, 1);
-				usb_rx_memory_needed--;
-				__enable_irq();
-				//serial_phex(i);
-				//serial_print(",odd\n");
-				return;
-			}
-		}
+	if (!(usb_endpoint_config_table[endpoint - 1] & USB_ENDPT_EPRXEN)) return 0;
+	size = usb_packet_size(endpoint);
+	//serial_print("rx_mem:");
+	__disable_irq();
+	if (table[index(endpoint, RX, EVEN)].desc == 0) {
+		table[index(endpoint, RX, EVEN)].addr = packet->buf;
+		table[index(endpoint, RX, EVEN)].desc = BDT_DESC(size, 0);
+		usb_rx_memory_needed--;
+		__enable_irq();
+		//serial_phex(endpoint);
+		//serial_print(",even\n");
+		return 1;
+	}
+	if (table[index(endpoint, RX, ODD)].desc == 0) {
+		table[index(endpoint, RX, ODD)].addr = packet->buf;
+		table[index(endpoint, RX, ODD)].desc = BDT_DESC(size, 1);
+		usb_rx_memory_needed--;
+		__enable_irq();
+		//serial_phex(endpoint);
+		//serial_print(",odd\n");
+		return 1;
 	}
 	__enable_irq();
-	// we should never reach this point.  If we get here, it means
-	// usb_rx_memory_needed was set greater than zero, but no memory
-	// was actually needed.
-	usb_rx_memory_needed = 0;
-	usb_free(packet);
-	return;
+	// this endpoint isn't waiting for memory, so the caller
+	// returns the packet to the pool
+	return 0;
 }
 
 //#define index(endpoint, tx, odd) (((endpoint) << 2) | ((tx) << 1) | (odd))
@@ -801,12 +828,14 @@ void usb_tx(uint32_t endpoint, usb_packet_t *packet)
 			tx_last[endpoint]->next = packet;
 		}
 		tx_last[endpoint] = packet;
+		usb_tx_packet_count_data[endpoint]++;
+		usb_tx_byte_count_data[endpoint] += packet->len;
 		__enable_irq();
 		return;
 	}
 	tx_state[endpoint] = next;
 	b->addr = packet->buf;
-	b->desc = BDT_DESC(packet->len, ((uint32_t)b & 8) ? DATA1 : DATA0);
+	b->desc = BDT_DESC(packet->len, bdt_odd(b) ? DATA1 : DATA0);
 	__enable_irq();
 }
 
@@ -842,17 +871,49 @@ void _reboot_Teensyduino_(void)
 
 
 //Wrapper using CMSIS name
-//Ppasses to usb_isr
+//Passes to usb_isr
+//usb_isr only services tokens and moves BDT ownership
+//Setup packets are handed to usb_task, which runs usb_setup() outside interrupt context
 void USB0_IRQHandler(void)
 {
-	// We could setup usb_isr() as a freeRTOS task with high priority
-	// Then give a semaphore here that it could wait for
-	//(Using xSemaphoreGiveFromISR (and vPortYieldFromISR to yield immediately))
-	// However the problem is that we'd have to clear the interrupt before issuing the semaphore
-	// I.e. USB0_ISTAT = 0xFF
-	// This would mess up the handling and clearing of the interrupts, so would require significant re-writing
-	// Instead, lets just call the ISR directly, since the USB_ISR is the highest priority thing in the system and nothing else is timing critical
+	uint32_t start, end, cycles, statsStart;
+
+	statsStart = statsIsrEnter();
+	traceRecord(TRACE_ISR_ENTER, TRACE_ISR_USB, 0);
+	usb_task_woken = pdFALSE;
+	start = SysTick->VAL;
 	usb_isr();
+	end = SysTick->VAL;
+
+	//SysTick counts down and reloads from LOAD, so allow for one wrap
+	cycles = (start >= end) ? (start - end) : (start + SysTick->LOAD + 1 - end);
+	if (cycles > usb_isr_max_cycles) usb_isr_max_cycles = cycles;
+
+	traceRecord(TRACE_ISR_EXIT, TRACE_ISR_USB, 0);
+	statsIsrExit(STATS_ISR_USB, statsStart);
+
+	portEND_SWITCHING_ISR(usb_task_woken);
+}
+
+//Task to handle control requests deferred by the ISR
+//Should be the highest priority task, as the USB is frozen until it runs
+void usb_task(void *pvParameters)
+{
+	while(1)
+	{
+		if (!usb_setup_pending) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		//Keep the USB interrupt out while usb_setup() changes the BDT and queues
+		//Other interrupts (SysTick, I2C) stay enabled
+		NVIC_DISABLE_IRQ(IRQ_USBOTG);
+		if (usb_setup_pending) {
+			usb_setup_pending = 0;
+			usb_setup();
+			// unfreeze the USB, now that we're ready
+			USB0_CTL = USB_CTL_USBENSOFEN; // clear TXSUSPENDTOKENBUSY bit
+		}
+		NVIC_ENABLE_IRQ(IRQ_USBOTG);
+	}
 }
 
 void usb_isr(void)
@@ -912,7 +973,7 @@ void usb_isr(void)
 			usb_control(stat);
 		} else {
 			bdt_t *b = stat2bufferdescriptor(stat);
-			usb_packet_t *packet = (usb_packet_t *)((uint8_t *)(b->addr) - 8);
+			usb_packet_t *packet = (usb_packet_t *)((uint8_t *)(b->addr) - USB_PACKET_HEADER_SIZE);
 #if 0
 			serial_print("ep:");
 			serial_phex(endpoint);
@@ -947,11 +1008,15 @@ void usb_isr(void)
 			} else
 #endif
 			if (stat & 0x08) { // transmit
+				// the host has the report now, so its data is as old as it will get
+				if (packet->timestamp) statsLatencyRecord(statsTimerRead() - packet->timestamp);
 				usb_free(packet);
 				packet = tx_first[endpoint];
 				if (packet) {
 					//serial_print("tx packet\n");
 					tx_first[endpoint] = packet->next;
+					usb_tx_packet_count_data[endpoint]--;
+					usb_tx_byte_count_data[endpoint] -= packet->len;
 					b->addr = packet->buf;
 					switch (tx_state[endpoint]) {
 					  case TX_STATE_BOTH_FREE_EVEN_FIRST:
@@ -970,7 +1035,7 @@ void usb_isr(void)
 						break;
 					}
 					b->desc = BDT_DESC(packet->len,
-						((uint32_t)b & 8) ? DATA1 : DATA0);
+						bdt_odd(b) ? DATA1 : DATA0);
 				} else {
 					//serial_print("tx no packet\n");
 					switch (tx_state[endpoint]) {
@@ -984,7 +1049,7 @@ void usb_isr(void)
 						tx_state[endpoint] = TX_STATE_BOTH_FREE_ODD_FIRST;
 						break;
 					  default:
-						tx_state[endpoint] = ((uint32_t)b & 8) ?
+						tx_state[endpoint] = bdt_odd(b) ?
 						  TX_STATE_ODD_FREE : TX_STATE_EVEN_FREE;
 						break;
 					}
@@ -1015,11 +1080,11 @@ void usb_isr(void)
 					// packets, so a flood of incoming data on 1 endpoint
 					// doesn't starve the others if the user isn't reading
 					// it regularly
-					packet = usb_malloc();
+					packet = usb_malloc(endpoint + 1);
 					if (packet) {
 						b->addr = packet->buf;
-						b->desc = BDT_DESC(64,
-							((uint32_t)b & 8) ? DATA1 : DATA0);
+						b->desc = BDT_DESC(usb_packet_size(endpoint + 1),
+							bdt_odd(b) ? DATA1 : DATA0);
 					} else {
 						//serial_print("starving ");
 						//serial_phex(endpoint + 1);
@@ -1027,7 +1092,7 @@ void usb_isr(void)
 						usb_rx_memory_needed++;
 					}
 				} else {
-					b->desc = BDT_DESC(64, ((uint32_t)b & 8) ? DATA1 : DATA0);
+					b->desc = BDT_DESC(usb_packet_size(endpoint + 1), bdt_odd(b) ? DATA1 : DATA0);
 				}
 			}
 
@@ -1043,6 +1108,9 @@ void usb_isr(void)
 		USB0_CTL = USB_CTL_ODDRST;
 		ep0_tx_bdt_bank = 0;
 
+		// drop any setup request usb_task hasn't handled yet
+		usb_setup_pending = 0;
+
 		// set up buffers to receive Setup and OUT packets
 		table[index(0, RX, EVEN)].desc = BDT_DESC(EP0_SIZE, 0);
 		table[index(0, RX, EVEN)].addr = ep0_rx0_buf;
@@ -35,25 +35,115 @@
 //#include "HardwareSerial.h"
 #include "usb_mem.h"
 
-__attribute__ ((section(".usbbuffers"), used))
-unsigned char usb_buffer_memory[NUM_USB_BUFFERS * sizeof(usb_packet_t)];
+// Each endpoint gets its own pool, sized from ENDPOINTn_SIZE and
+// ENDPOINTn_BUFFERS in usb_desc.h.  An endpoint with no buffers
+// defined (e.g. EP0, which uses its own static buffers) gets no pool.
+#define USB_POOL_MEMORY(n) \
+	__attribute__ ((section(".usbbuffers"), used, aligned(4))) \
+	static uint8_t usb_pool##n##_memory[ENDPOINT##n##_BUFFERS * USB_PACKET_STRIDE(ENDPOINT##n##_SIZE)];
+#define USB_POOL_ENTRY(n) \
+	{usb_pool##n##_memory, USB_PACKET_STRIDE(ENDPOINT##n##_SIZE), ENDPOINT##n##_SIZE, ENDPOINT##n##_BUFFERS}
+#define USB_POOL_EMPTY \
+	{NULL, 0, 0, 0}
 
-static uint32_t usb_buffer_available = 0xFFFFFFFF;
+#if NUM_ENDPOINTS > 4
+#error "usb_mem.c only describes pools for endpoints 1-4"
+#endif
+
+#if (defined(ENDPOINT1_BUFFERS) && NUM_ENDPOINTS >= 1)
+USB_POOL_MEMORY(1)
+#define USB_POOL1_RAM sizeof(usb_pool1_memory)
+#else
+#define USB_POOL1_RAM 0
+#endif
+#if (defined(ENDPOINT2_BUFFERS) && NUM_ENDPOINTS >= 2)
+USB_POOL_MEMORY(2)
+#define USB_POOL2_RAM sizeof(usb_pool2_memory)
+#else
+#define USB_POOL2_RAM 0
+#endif
+#if (defined(ENDPOINT3_BUFFERS) && NUM_ENDPOINTS >= 3)
+USB_POOL_MEMORY(3)
+#define USB_POOL3_RAM sizeof(usb_pool3_memory)
+#else
+#define USB_POOL3_RAM 0
+#endif
+#if (defined(ENDPOINT4_BUFFERS) && NUM_ENDPOINTS >= 4)
+USB_POOL_MEMORY(4)
+#define USB_POOL4_RAM sizeof(usb_pool4_memory)
+#else
+#define USB_POOL4_RAM 0
+#endif
+
+#define USB_BUFFER_RAM_TOTAL (USB_POOL1_RAM + USB_POOL2_RAM + USB_POOL3_RAM + USB_POOL4_RAM)
+
+typedef struct {
+	uint8_t *memory;
+	uint16_t stride; // bytes from one packet to the next (header + aligned payload)
+	uint16_t size;   // payload bytes per packet
+	uint8_t count;   // packets in the pool, at most 32 (one free mask bit each)
+} usb_pool_t;
+
+static const usb_pool_t usb_pool[NUM_ENDPOINTS] = {
+#if (defined(ENDPOINT1_BUFFERS) && NUM_ENDPOINTS >= 1)
+	USB_POOL_ENTRY(1),
+#elif (NUM_ENDPOINTS >= 1)
+	USB_POOL_EMPTY,
+#endif
+#if (defined(ENDPOINT2_BUFFERS) && NUM_ENDPOINTS >= 2)
+	USB_POOL_ENTRY(2),
+#elif (NUM_ENDPOINTS >= 2)
+	USB_POOL_EMPTY,
+#endif
+#if (defined(ENDPOINT3_BUFFERS) && NUM_ENDPOINTS >= 3)
+	USB_POOL_ENTRY(3),
+#elif (NUM_ENDPOINTS >= 3)
+	USB_POOL_EMPTY,
+#endif
+#if (defined(ENDPOINT4_BUFFERS) && NUM_ENDPOINTS >= 4)
+	USB_POOL_ENTRY(4),
+#elif (NUM_ENDPOINTS >= 4)
+	USB_POOL_EMPTY,
+#endif
+};
+
+// Build-time RAM check.  The map file lists each usb_poolN_memory symbol,
+// and the build fails here if their total goes over USB_BUFFER_RAM_BUDGET.
+typedef char usb_buffer_ram_budget_exceeded[(USB_BUFFER_RAM_TOTAL <= USB_BUFFER_RAM_BUDGET) ? 1 : -1];
+
+// One free mask per pool, MSB first
+static uint32_t usb_buffer_available[NUM_ENDPOINTS] = {
+	0xFFFFFFFF,
+#if NUM_ENDPOINTS >= 2
+	0xFFFFFFFF,
+#endif
+#if NUM_ENDPOINTS >= 3
+	0xFFFFFFFF,
+#endif
+#if NUM_ENDPOINTS >= 4
+	0xFFFFFFFF,
+#endif
+};
 
 // use bitmask and CLZ instruction to implement fast free list
 // http://www.archivum.info/gnu.gcc.help/2006-08/00148/Re-GCC-Inline-Assembly.html
 // http://gcc.gnu.org/ml/gcc/2012-06/msg00015.html
 // __builtin_clz()
 
-usb_packet_t * usb_malloc(void)
+usb_packet_t * usb_malloc(uint32_t endpoint)
 {
 	unsigned int n, avail;
 	uint8_t *p;
+	const usb_pool_t *pool;
+
+	endpoint--;
+	if (endpoint >= NUM_ENDPOINTS) return NULL;
+	pool = &usb_pool[endpoint];
 
 	__disable_irq();
-	avail = usb_buffer_available;
+	avail = usb_buffer_available[endpoint];
 	n = __builtin_clz(avail); // clz = count leading zeros
-	if (n >= NUM_USB_BUFFERS) {
+	if (n >= pool->count) {
 		__enable_irq();
 		return NULL;
 	}
@@ -61,44 +151,60 @@ usb_packet_t * usb_malloc(void)
 	//serial_phex(n);
 	//serial_print("\n");
 
-	usb_buffer_available = avail & ~(0x80000000 >> n);
+	usb_buffer_available[endpoint] = avail & ~(0x80000000 >> n);
 	__enable_irq();
-	p = usb_buffer_memory + (n * sizeof(usb_packet_t));
+	p = pool->memory + (n * pool->stride);
 	//serial_print("malloc:");
 	//serial_phex32((int)p);
 	//serial_print("\n");
-	*(uint32_t *)p = 0;
-	*(uint32_t *)(p + 4) = 0;
+	// Clear by field, so next is cleared wherever the pointer size puts it
+	((usb_packet_t *)p)->len = 0;
+	((usb_packet_t *)p)->index = 0;
+	((usb_packet_t *)p)->next = NULL;
+	((usb_packet_t *)p)->timestamp = 0;
 	return (usb_packet_t *)p;
 }
 
+uint32_t usb_packet_size(uint32_t endpoint)
+{
+	endpoint--;
+	if (endpoint >= NUM_ENDPOINTS) return 0;
+	return usb_pool[endpoint].size;
+}
+
 // for the receive endpoints to request memory
 extern uint8_t usb_rx_memory_needed;
-extern void usb_rx_memory(usb_packet_t *packet);
+extern int usb_rx_memory(uint32_t endpoint, usb_packet_t *packet);
 
 void usb_free(usb_packet_t *p)
 {
-	unsigned int n, mask;
+	unsigned int i, n, mask;
+	const usb_pool_t *pool;
 
+	// find the pool this packet came from
+	for (i=0; i < NUM_ENDPOINTS; i++) {
+		pool = &usb_pool[i];
+		if ((uint8_t *)p >= pool->memory &&
+		  (uint8_t *)p < pool->memory + pool->count * pool->stride) break;
+	}
+	if (i >= NUM_ENDPOINTS) return;
+	n = ((uint8_t *)p - pool->memory) / pool->stride;
 	//serial_print("free:");
-	n = ((uint8_t *)p - usb_buffer_memory) / sizeof(usb_packet_t);
-	if (n >= NUM_USB_BUFFERS) return;
 	//serial_phex(n);
 	//serial_print("\n");
 
-	// if any endpoints are starving for memory to receive
-	// packets, give this memory to them immediately!
+	// if this endpoint is starving for memory to receive
+	// packets, give this memory to it immediately!
 	if (usb_rx_memory_needed && usb_configuration) {
 		//serial_print("give to rx:");
 		//serial_phex32((int)p);
 		//serial_print("\n");
-		usb_rx_memory(p);
-		return;
+		if (usb_rx_memory(i + 1, p)) return;
 	}
 
 	mask = (0x80000000 >> n);
 	__disable_irq();
-	usb_buffer_available |= mask;
+	usb_buffer_available[i] |= mask;
 	__enable_irq();
 
 	//serial_print("free:");
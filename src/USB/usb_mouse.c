@@ -36,6 +36,16 @@
 
 #ifdef MOUSE_INTERFACE // defined by usb_dev.h -> usb_desc.h
 
+// Idle rate set by the host with HID SET_IDLE, in 4 ms units
+// 0 (the default for a mouse) means only report when something changes
+volatile uint8_t usb_mouse_idle_rate = 0;
+
+// Idle period in ms, or 0 for infinite
+uint32_t usb_mouse_idle_ms(void)
+{
+        return (uint32_t)usb_mouse_idle_rate * 4;
+}
+
 // Set the mouse buttons.  To create a "click", 2 calls are needed,
 // one to push the button down and the second to release it
 // Note API has been changed here to make this function return the mask instead of sending message directly
@@ -57,6 +67,9 @@ uint8_t usb_mouse_buttons(uint8_t left, uint8_t middle, uint8_t right, uint8_t b
 
 static uint8_t transmit_previous_timeout=0;
 
+// When the data in the next reports was sampled, for latency measurement
+static uint32_t usb_mouse_sample_time=0;
+
 // When the PC isn't listening, how long do we wait before discarding data?
 #define TX_TIMEOUT_MSEC 30
 
@@ -64,36 +77,56 @@ static uint8_t transmit_previous_timeout=0;
 #define TX_TIMEOUT (TX_TIMEOUT_MSEC * 428)
 
 
-// Send mouse data.  x, y and wheel are -127 to 127.  Use 0 for no movement.
-// usb_mouse_buttons_state is the mask returned by usb_mouse_buttons
-int usb_mouse_send_data(int8_t x, int8_t y, int8_t wheel, int8_t horiz, uint8_t usb_mouse_buttons_state)
+// Get a packet to build a report in, waiting if the endpoint is busy.
+// Both report types are built directly in the returned USB buffer.
+// Returns NULL if not configured or the PC isn't listening.
+static usb_packet_t * usb_mouse_get_packet(void)
 {
         uint32_t wait_count=0;
         usb_packet_t *tx_packet;
 
-        //serial_print("move");
-        //serial_print("\n");
-        if (x == -128) x = -127;
-        if (y == -128) y = -127;
-        if (wheel == -128) wheel = -127;
-        if (horiz == -128) horiz = -127;
-
         while (1) {
                 if (!usb_configuration) {
-                        return -1;
+                        return NULL;
                 }
                 if (usb_tx_packet_count(MOUSE_ENDPOINT) < TX_PACKET_LIMIT) {
-                        tx_packet = usb_malloc();
+                        tx_packet = usb_malloc(MOUSE_ENDPOINT);
                         if (tx_packet) break;
                 }
                 if (++wait_count > TX_TIMEOUT || transmit_previous_timeout) {
                         transmit_previous_timeout = 1;
-                        return -1;
+                        return NULL;
                 }
 								//Delay instead of yield as this will be fairly high priority, and we want to give lower priority tasks a chance
                 vTaskDelay(1/portTICK_RATE_MS);
         }
         transmit_previous_timeout = 0;
+        tx_packet->timestamp = usb_mouse_sample_time;
+        return tx_packet;
+}
+
+// Set when the data in the following reports was sampled (statsTimerRead()).
+// The USB interrupt measures the latency from then until the host reads the report.
+void usb_mouse_set_sample_time(uint32_t time)
+{
+        usb_mouse_sample_time = time;
+}
+
+// Send mouse data.  x, y and wheel are -127 to 127.  Use 0 for no movement.
+// usb_mouse_buttons_state is the mask returned by usb_mouse_buttons
+int usb_mouse_send_data(int8_t x, int8_t y, int8_t wheel, int8_t horiz, uint8_t usb_mouse_buttons_state)
+{
+        usb_packet_t *tx_packet;
+
+        //serial_print("move");
+        //serial_print("\n");
+        if (x == -128) x = -127;
+        if (y == -128) y = -127;
+        if (wheel == -128) wheel = -127;
+        if (horiz == -128) horiz = -127;
+
+        tx_packet = usb_mouse_get_packet();
+        if (!tx_packet) return -1;
         *(tx_packet->buf + 0) = 1;
         *(tx_packet->buf + 1) = usb_mouse_buttons_state;
         *(tx_packet->buf + 2) = x;
@@ -105,5 +138,57 @@ int usb_mouse_send_data(int8_t x, int8_t y, int8_t wheel, int8_t horiz, uint8_t
         return 0;
 }
 
+// Send mouse data with 16-bit motion (report ID 3), for movements too big for usb_mouse_send_data.
+// x, y, wheel and horiz are -32767 to 32767.
+// Each report ID is its own top level collection, which Windows treats as a separate mouse.
+// Buttons are only in report ID 1, so they can't be pressed by one and left held in another.
+// Send them with usb_mouse_send_data
+int usb_mouse_send_data16(int16_t x, int16_t y, int16_t wheel, int16_t horiz)
+{
+        usb_packet_t *tx_packet;
+
+        if (x == -32768) x = -32767;
+        if (y == -32768) y = -32767;
+        if (wheel == -32768) wheel = -32767;
+        if (horiz == -32768) horiz = -32767;
+
+        tx_packet = usb_mouse_get_packet();
+        if (!tx_packet) return -1;
+        *(tx_packet->buf + 0) = 3;
+        *(tx_packet->buf + 1) = x & 0xFF;
+        *(tx_packet->buf + 2) = (x >> 8) & 0xFF;
+        *(tx_packet->buf + 3) = y & 0xFF;
+        *(tx_packet->buf + 4) = (y >> 8) & 0xFF;
+        *(tx_packet->buf + 5) = wheel & 0xFF;
+        *(tx_packet->buf + 6) = (wheel >> 8) & 0xFF;
+        *(tx_packet->buf + 7) = horiz & 0xFF;
+        *(tx_packet->buf + 8) = (horiz >> 8) & 0xFF; // horizontal scroll
+        tx_packet->len = 9;
+        usb_tx(MOUSE_ENDPOINT, tx_packet);
+        return 0;
+}
+
+// Move the pointer to an absolute position (report ID 2).
+// x and y are 0 to 32767, covering the whole screen.
+// This report has no buttons, so send those with usb_mouse_send_data
+int usb_mouse_send_absolute(uint16_t x, uint16_t y)
+{
+        usb_packet_t *tx_packet;
+
+        if (x > MOUSE_ABSOLUTE_MAX) x = MOUSE_ABSOLUTE_MAX;
+        if (y > MOUSE_ABSOLUTE_MAX) y = MOUSE_ABSOLUTE_MAX;
+
+        tx_packet = usb_mouse_get_packet();
+        if (!tx_packet) return -1;
+        *(tx_packet->buf + 0) = 2;
+        *(tx_packet->buf + 1) = x & 0xFF;
+        *(tx_packet->buf + 2) = x >> 8;
+        *(tx_packet->buf + 3) = y & 0xFF;
+        *(tx_packet->buf + 4) = y >> 8;
+        tx_packet->len = 5;
+        usb_tx(MOUSE_ENDPOINT, tx_packet);
+        return 0;
+}
+
 
 #endif // MOUSE_INTERFACE
@@ -12,8 +12,6 @@
 //FreeRTOS libraries
 #include "FreeRTOS.h"
 #include "task.h"
-#include "queue.h"
-#include "semphr.h"
 
 
 //User libraries
@@ -23,19 +21,47 @@
 #include "clock_config.h" //Clock configuration
 #include "usb_dev.h" //USB Initialisation
 #include "gpio.h" //To read buttons
+#include "buttons.h" //Button events
 #include "lcd.h" //Drive LCD
 #include "touch.h" //Read touch sensor
 #include "iic.h" //Read accelerometer
 #include "filter.h" //Filter data
+#include "console.h" //Command console
+#include "kvstore.h" //Settings saved in flash
+#include "params.h" //Runtime tuning
 
-#define STACK_SIZE		( ( unsigned short ) 128 )
-	
+//All kernel objects are allocated statically, so there is no heap and nothing can fail to allocate at runtime
+//Task stacks and control blocks
+static StackType_t usbStack[USB_STACK_SIZE];
+static StaticTask_t usbTcb;
+static StackType_t heartbeatStack[HEARTBEAT_STACK_SIZE];
+static StaticTask_t heartbeatTcb;
+static StackType_t lcdStack[LCD_STACK_SIZE];
+static StaticTask_t lcdTcb;
+static StackType_t touchStack[TOUCH_STACK_SIZE];
+static StaticTask_t touchTcb;
+static StackType_t accelStack[ACCEL_STACK_SIZE];
+static StaticTask_t accelTcb;
+static StackType_t gatherStack[GATHER_STACK_SIZE];
+static StaticTask_t gatherTcb;
+static StackType_t sendStack[SEND_STACK_SIZE];
+static StaticTask_t sendTcb;
+static StackType_t consoleStack[CONSOLE_STACK_SIZE];
+static StaticTask_t consoleTcb;
+
+//Idle and timer service tasks, handed to the kernel by the hooks below
+static StackType_t idleStack[configMINIMAL_STACK_SIZE];
+static StaticTask_t idleTcb;
+static StackType_t timerStack[configTIMER_TASK_STACK_DEPTH];
+static StaticTask_t timerTcb;
 
-//Queues. Defined in rtos_tasks.c
-//Queue to send mouse data from gather task to send task
-extern xQueueHandle mouseDataQueue;
-//Queue to send peripheral reports to gather task
-extern xQueueHandle peripheralReportQueue;
+//RAM for task memory may not exceed the heap it replaced
+//The build fails here if it does
+#define TASK_RAM_BUDGET 6500
+#define TASK_STACK_WORDS (USB_STACK_SIZE + HEARTBEAT_STACK_SIZE + LCD_STACK_SIZE + TOUCH_STACK_SIZE + ACCEL_STACK_SIZE + GATHER_STACK_SIZE + SEND_STACK_SIZE + CONSOLE_STACK_SIZE \
+                          + configMINIMAL_STACK_SIZE + configTIMER_TASK_STACK_DEPTH)
+#define TASK_RAM_TOTAL (TASK_STACK_WORDS*sizeof(StackType_t) + 10*sizeof(StaticTask_t))
+typedef char task_ram_budget_exceeded[(TASK_RAM_TOTAL <= TASK_RAM_BUDGET) ? 1 : -1];
 
 int main(void)
 {
@@ -45,49 +71,70 @@ int main(void)
 	
 	//Setup peripherals
 	gpio_init();
-	uart_init(115200);
+	buttons_init();
+	uart_init(230400); //Fast enough for the telemetry stream, see telemetry.h
 	usb_init();
 	lcd_init();
+	
+	//Settings saved in flash are needed by touch_init, and should be in place before the tasks start
+	kvstoreInit();
+	paramsLoad();
 	touch_init();
 	
 	BOARD_I2C_ReleaseBus();
 	BOARD_I2C_ConfigurePins();
 	
-	//Queue to transfer data from gather to send
-	//Note queue only holds 1 item to ensure that data is up to date
-	mouseDataQueue = xQueueCreate(1, sizeof(mouseData_t));
-	
-	//Queue to hold reports from peripherals before being assembled by gather
-	//Queue is large enough to hold one report from each peripheral
-	peripheralReportQueue = xQueueCreate(2, sizeof(peripheralData_t));
+	//USB task
+	//Handle USB control requests deferred from the USB interrupt
+	usb_task_handle = xTaskCreateStatic(usb_task, (const char *)"USB", USB_STACK_SIZE, (void *)NULL, configMAX_PRIORITIES-1, usbStack, &usbTcb);
 
 	//Heartbeat task
 	//Blink LED and send UART message *at lowest priority* to indicate that we're still alive
-	xTaskCreate(heartbeat, (const char *)"Heartbeat", STACK_SIZE, (void *)NULL, tskIDLE_PRIORITY, NULL);
+	heartbeatTaskHandle = xTaskCreateStatic(heartbeat, (const char *)"Heartbeat", HEARTBEAT_STACK_SIZE, (void *)NULL, tskIDLE_PRIORITY, heartbeatStack, &heartbeatTcb);
 	
 	//LCD task
 	//Display strings on LCD
-	xTaskCreate(lcd, (const char *)"LCD", STACK_SIZE, (void *)NULL, tskIDLE_PRIORITY, NULL);
+	lcdTaskHandle = xTaskCreateStatic(lcd, (const char *)"LCD", LCD_STACK_SIZE, (void *)NULL, tskIDLE_PRIORITY, lcdStack, &lcdTcb);
 	
 	//Touch task
 	//Read touch sensor
-	xTaskCreate(touch, (const char *)"Touch", STACK_SIZE, (void *)NULL, configMAX_PRIORITIES-2, NULL);
+	touchTaskHandle = xTaskCreateStatic(touch, (const char *)"Touch", TOUCH_STACK_SIZE, (void *)NULL, configMAX_PRIORITIES-3, touchStack, &touchTcb);
 	
 	//Accel task
 	//Read accelerometer
-	xTaskCreate(accel, (const char *)"Accel", STACK_SIZE, (void *)NULL, configMAX_PRIORITIES-2, NULL);
+	accelTaskHandle = xTaskCreateStatic(accel, (const char *)"Accel", ACCEL_STACK_SIZE, (void *)NULL, configMAX_PRIORITIES-3, accelStack, &accelTcb);
 	
 	//Gather task
 	//Get sensor data and send to send task
-	xTaskCreate(gather, (const char *)"Gather", STACK_SIZE, (void *)NULL, configMAX_PRIORITIES-1, NULL);
+	gatherTaskHandle = xTaskCreateStatic(gather, (const char *)"Gather", GATHER_STACK_SIZE, (void *)NULL, configMAX_PRIORITIES-2, gatherStack, &gatherTcb);
 	
 	//Send task
 	//Send mouse data via USB
-	xTaskCreate(send, (const char *)"Send", STACK_SIZE, (void *)NULL, configMAX_PRIORITIES, NULL);
+	sendTaskHandle = xTaskCreateStatic(send, (const char *)"Send", SEND_STACK_SIZE, (void *)NULL, configMAX_PRIORITIES-2, sendStack, &sendTcb);
+	
+	//Console task
+	//Run commands typed at the debug UART
+	consoleTaskHandle = xTaskCreateStatic(consoleTask, (const char *)"Console", CONSOLE_STACK_SIZE, (void *)NULL, tskIDLE_PRIORITY+1, consoleStack, &consoleTcb);
 
 	vTaskStartScheduler();
 
 	return 0;
 }
 
+//Memory for the idle task, called by vTaskStartScheduler
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer, uint32_t *pulIdleTaskStackSize)
+{
+	*ppxIdleTaskTCBBuffer = &idleTcb;
+	*ppxIdleTaskStackBuffer = idleStack;
+	*pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+//Memory for the timer service task, called by vTaskStartScheduler
+void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer, StackType_t **ppxTimerTaskStackBuffer, uint32_t *pulTimerTaskStackSize)
+{
+	*ppxTimerTaskTCBBuffer = &timerTcb;
+	*ppxTimerTaskStackBuffer = timerStack;
+	*pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+
 
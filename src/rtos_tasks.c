@@ -17,8 +17,7 @@
 //FreeRTOS libraries
 #include "FreeRTOS.h"
 #include "task.h"
-#include "queue.h"
-#include "semphr.h"
+#include "timers.h"
 
 //User libraries
 #include "uart.h" //UART Setup
@@ -26,85 +25,389 @@
 #include "clock_config.h" //Clock configuration
 #include "usb_dev.h" //USB Initialisation
 #include "usb_mouse.h" //Mouse user interface
-#include "gpio.h" //To read buttons
+#include "gpio.h" //To drive LEDs
+#include "buttons.h" //Button events
 #include "lcd.h" //Drive LCD
 #include "touch.h" //Read touch sensor
 #include "iic.h" //Read accelerometer
 #include "filter.h" //Filter data
+#include "motion.h" //Integrate accelerometer motion
+#include "ballistics.h" //Pointer acceleration curves
+#include "gesture.h" //Tilt gestures
+#include "stats.h" //CPU load summary
+#include "log.h" //Binary logging
+#include "telemetry.h" //Sensor data stream
+#include "params.h" //Runtime tuning
+#include "console.h" //Console task handle, for stack profiling
 
 
-//Queue to send mouse data from gather task to send task
-xQueueHandle mouseDataQueue = NULL;
+//Task handles, for notifications and stack profiling. Set by main when the tasks are created
+TaskHandle_t heartbeatTaskHandle = NULL;
+TaskHandle_t lcdTaskHandle = NULL;
+TaskHandle_t gatherTaskHandle = NULL;
+TaskHandle_t sendTaskHandle = NULL;
+TaskHandle_t touchTaskHandle = NULL;
+TaskHandle_t accelTaskHandle = NULL;
 
-//Queue to send peripheral reports to gather task
-xQueueHandle peripheralReportQueue = NULL;
+//Reports are passed through shared variables, with task notifications saying when they are ready
+//gather notifies a peripheral task to request a report. The peripheral writes its report, then notifies gather with its bit
+//gather only reads a report after getting the bit, and doesn't ask again until it has read it, so no lock is needed
+static peripheralData_t touchReport;
+static peripheralData_t accelReport;
 
-//Signals to request a report from each peripheral
-static xSemaphoreHandle scrollReportSignal = 0;
-static xSemaphoreHandle accelReportSignal = 0;
+//Mouse data from gather to send
+//gather writes it and notifies send. send copies it, then gives NOTIFY_SEND_DONE back before gather may write it again
+static mouseData_t mouseReport;
 
+//Notification bits for gather
+#define NOTIFY_TOUCH_REPORT 0x01
+#define NOTIFY_ACCEL_REPORT 0x02
+#define NOTIFY_SEND_DONE 0x04
 
+//True when tilt sets an absolute pointer position rather than a speed
+//Toggled by gather when both buttons are held, read by accel
+static volatile bool absoluteMode = false;
 
 
+
+
+#if STACK_PROFILE
+//Print the stack use of every task, and a suggested size
+//Stacks are painted when tasks are created, so the high water mark is the least free space there has ever been
+static void stackProfileReport(void)
+{
+	const struct
+	{
+		const char *name;
+		TaskHandle_t handle;
+		uint32_t size;
+	} tasks[] = {
+		{"USB", usb_task_handle, USB_STACK_SIZE},
+		{"Gather", gatherTaskHandle, GATHER_STACK_SIZE},
+		{"Send", sendTaskHandle, SEND_STACK_SIZE},
+		{"Touch", touchTaskHandle, TOUCH_STACK_SIZE},
+		{"Accel", accelTaskHandle, ACCEL_STACK_SIZE},
+		{"LCD", lcdTaskHandle, LCD_STACK_SIZE},
+		{"Heartbeat", heartbeatTaskHandle, HEARTBEAT_STACK_SIZE},
+		{"Console", consoleTaskHandle, CONSOLE_STACK_SIZE},
+		{"Idle", xTaskGetIdleTaskHandle(), configMINIMAL_STACK_SIZE},
+		{"Timer", xTimerGetTimerDaemonTaskHandle(), configTIMER_TASK_STACK_DEPTH}
+	};
+	
+	dbg_puts("Task: size used suggested (words)\r\n");
+	for(int i=0; i<sizeof(tasks)/sizeof(tasks[0]); i++)
+	{
+		uint32_t used = tasks[i].size - uxTaskGetStackHighWaterMark(tasks[i].handle);
+		//A quarter again as margin, rounded up to a multiple of 8 words
+		uint32_t suggested = ((used + used/4) + 7) & ~7u;
+		
+		dbg_puts(tasks[i].name);
+		dbg_puts(": ");
+		dbg_putdec(tasks[i].size);
+		dbg_puts(" ");
+		dbg_putdec(used);
+		dbg_puts(" ");
+		dbg_putdec(suggested);
+		dbg_puts("\r\n");
+		dbg_flush(); //The whole report doesn't fit in the UART buffer
+	}
+}
+#endif
+
 //Heartbeat task to show that system is still alive
 //Blink LEDs and send UART message every second
 //Also send system up message on boot
 //Hardcoded for green LED (PTD5) on KL-46Z dev board
 void heartbeat(void *pvParameters)
 {
-	dbg_puts("USB Mouse begin.\r\n");
+	uint32_t lastDropped = 0;
+	uint32_t lastTelemetryDropped = 0;
+#if configUSE_TICKLESS_IDLE
+	uint32_t lastSleepCount = 0;
+	uint32_t lastSleepTicks = 0;
+	TickType_t lastTick = xTaskGetTickCount();
+#endif
+	
+	LOG_MSG0(LOG_BOOT);
+	LOG_MSG(LOG_UART_BAUD, uart_baud(), uart_baud_error_ppm());
 	setLED1();
 	clearLED2();
 	while(1)
 	{
 		toggleLED1();
 		toggleLED2();
-		dbg_puts("Heartbeat\r\n");
+		LOG_MSG0(LOG_HEARTBEAT);
+		statsReport();
+		statsLatencyReport();
+#if configUSE_TICKLESS_IDLE
+		//Tickless sleeps since the last heartbeat, and the ticks spent in them out of those that passed
+		//Zero if nothing ever leaves the core idle for configEXPECTED_IDLE_TIME_BEFORE_SLEEP ticks
+		uint32_t sleepCount = ulPortSleepCount;
+		uint32_t sleepTicks = ulPortSleepTicks;
+		TickType_t tick = xTaskGetTickCount();
+		LOG_MSG(LOG_SLEEP, sleepCount - lastSleepCount, sleepTicks - lastSleepTicks, tick - lastTick);
+		lastSleepCount = sleepCount;
+		lastSleepTicks = sleepTicks;
+		lastTick = tick;
+#endif
+		//Say if output has been lost because it was written faster than the UART could send it
+		if(uartDropped != lastDropped)
+		{
+			lastDropped = uartDropped;
+			LOG_MSG(LOG_UART_DROPPED, lastDropped);
+		}
+		if(telemetryDropped != lastTelemetryDropped)
+		{
+			lastTelemetryDropped = telemetryDropped;
+			LOG_MSG(LOG_TELEMETRY_DROPPED, lastTelemetryDropped);
+		}
+#if STACK_PROFILE
+		stackProfileReport();
+#endif
 		vTaskDelay(1000/portTICK_RATE_MS);
 	}
 }
 
 
+//Wait until gather has been notified of all the given bits, and clear them
+//Bits that arrive for something else are kept in received
+static void gatherWait(uint32_t *received, uint32_t bits)
+{
+	while((*received & bits) != bits)
+	{
+		uint32_t value;
+		xTaskNotifyWait(0, UINT32_MAX, &value, portMAX_DELAY);
+		*received |= value;
+	}
+	*received &= ~bits;
+}
+
 void gather(void *pvParameters)
 {
-	//Create semaphores which request data
-	scrollReportSignal = xSemaphoreCreateBinary();
-	accelReportSignal = xSemaphoreCreateBinary();
+	const peripheralData_t *reports[] = {&touchReport, &accelReport};
+	mouseData_t data = {0,0,0,0,0,false,0};
+	
+	//Notification bits received but not yet used. send starts idle
+	uint32_t received = NOTIFY_SEND_DONE;
+	
+	//Holding both buttons for this long toggles absolute mode
+	const TickType_t modeChordTime = 500/portTICK_RATE_MS;
+	TickType_t chordStart = 0;
+	bool chordHeld = false;
+	bool chordDone = false;
+	
+	//Last report sent, to suppress reports while nothing changes
+	uint8_t lastBtn = 0;
+	int16_t lastX = 0, lastY = 0;
+	TickType_t lastReport = 0;
+	
+	//Time of the oldest button edge taken since the last report, for latency measurement
+	uint32_t edgeTime = 0;
+	bool haveEdge = false;
+	
+	//Button state as of the edges taken so far
+	bool pressed[BUTTON_COUNT];
+	for(int i=0; i<BUTTON_COUNT; i++)
+	{
+		pressed[i] = buttonsPressed((button_t)i);
+	}
 	
-	peripheralData_t periphData;
-	mouseData_t data = {0,0,0,0};
+	//SW2 is the right button, but holding it while using the touch strip pans instead of scrolling
+	//A right press isn't sent until it is known not to be a pan: either the button is held this long
+	//without strip use starting, or it is released, in which case a whole click is sent
+	//Strip use is movement, or a finger landing. The touch task doesn't count movement until touch_settle samples
+	//after the finger lands (200ms by default), which would use up most of the time, so the landing is taken instead
+	//A finger already resting on the strip when SW2 is pressed isn't a landing. It has to move, or lift and land again
+	const TickType_t panDecideTime = 300/portTICK_RATE_MS;
+	bool fingerOnStrip = false;
+	bool fingerBefore = false; //fingerOnStrip as of the last report
+	bool fingerResting = false; //On the strip since before SW2 was pressed
+	enum
+	{
+		RIGHT_UP,
+		RIGHT_UNDECIDED, //Pressed, could still become a pan
+		RIGHT_DOWN, //Pressed, sent to host
+		RIGHT_CLICK, //Released before deciding. Send a press now and the release in the next report
+		RIGHT_PAN, //Panning. Never sent to host
+		RIGHT_CHORD //Part of the mode chord. Never sent to host
+	} rightState = RIGHT_UP;
+	TickType_t rightStart = 0;
+	motionKinetic_t pan = MOTION_KINETIC_INIT;
+	
+	//Report period is report_ms. This shorter one is used while button edges are still waiting to go out
+	const TickType_t pendingDelay = MOUSE_INTERVAL/portTICK_RATE_MS;
 	while(1)
 	{
-		xSemaphoreGive(scrollReportSignal);
-		xSemaphoreGive(accelReportSignal);
+		xTaskNotifyGive(touchTaskHandle);
+		xTaskNotifyGive(accelTaskHandle);
+		gatherWait(&received, NOTIFY_TOUCH_REPORT | NOTIFY_ACCEL_REPORT);
+		
+		uint8_t pulseBtn = 0;
+		uint32_t touchTime = 0, accelTime = 0;
 		for(int i=0; i<2; i++)
 		{
-			xQueueReceive(peripheralReportQueue, &periphData, portMAX_DELAY);
-			if(periphData.source == TOUCH)
+			const peripheralData_t *periphData = reports[i];
+			pulseBtn |= periphData->btn;
+			if(periphData->source == TOUCH)
 			{
-				data.scroll = periphData.payload1;
-			} else if(periphData.source == ACCEL) {
-				data.x = periphData.payload1;
-				data.y = periphData.payload2;
+				data.scroll = periphData->payload1;
+				fingerOnStrip = (periphData->payload2 != 0);
+				touchTime = periphData->time;
+			} else if(periphData->source == ACCEL || periphData->source == ACCEL_ABSOLUTE) {
+				accelTime = periphData->time;
+				data.x = periphData->payload1;
+				data.y = periphData->payload2;
+				data.absolute = (periphData->source == ACCEL_ABSOLUTE);
 			} else {
 				//Invalid
 				dbg_puts("Invalid peripheral.\r\n");
 			}
 		}
-		data.btn = usb_mouse_buttons(readSW1(), 0, readSW2(), 0, 0);
-		xQueueSend(mouseDataQueue, &data, portMAX_DELAY); //Send data to queue, wait forever for it to be accepted
+		TickType_t now = xTaskGetTickCount();
+		
+		//Take button edges in order, but only one per button per report
+		//A press and release in the same period then go out in consecutive reports rather than being lost
+		bool edgeTaken[BUTTON_COUNT] = {false};
+		buttonEvent_t event;
+		while(buttonsPeekEvent(&event) && !edgeTaken[event.button])
+		{
+			buttonsGetEvent(&event);
+			pressed[event.button] = event.pressed;
+			edgeTaken[event.button] = true;
+			if(!haveEdge)
+			{
+				edgeTime = event.time;
+				haveEdge = true;
+			}
+		}
+		
+		//Both buttons held is a chord to toggle absolute mode, rather than a click
+		if(pressed[BUTTON_SW1] && pressed[BUTTON_SW2])
+		{
+			if(!chordHeld)
+			{
+				chordHeld = true;
+				chordDone = false;
+				chordStart = now;
+			} else if(!chordDone && (now - chordStart) >= modeChordTime) {
+				absoluteMode = !absoluteMode;
+				chordDone = true;
+				dbg_puts(absoluteMode ? "Absolute mode\r\n" : "Relative mode\r\n");
+			}
+			rightState = RIGHT_CHORD;
+			data.btn = 0;
+		} else {
+			chordHeld = false;
+			
+			if(pressed[BUTTON_SW2])
+			{
+				if(rightState == RIGHT_UP || rightState == RIGHT_CLICK)
+				{
+					rightState = RIGHT_UNDECIDED;
+					rightStart = now;
+					fingerResting = fingerBefore;
+				}
+				if(rightState == RIGHT_UNDECIDED)
+				{
+					fingerResting = fingerResting && fingerOnStrip;
+					if(data.scroll != 0 || (fingerOnStrip && !fingerResting))
+					{
+						rightState = RIGHT_PAN;
+					} else if((now - rightStart) >= panDecideTime) {
+						rightState = RIGHT_DOWN;
+					}
+				}
+			} else {
+				rightState = (rightState == RIGHT_UNDECIDED ? RIGHT_CLICK : RIGHT_UP);
+			}
+			
+			bool right = (rightState == RIGHT_DOWN || rightState == RIGHT_CLICK);
+			//Pulses are only set for one report, so the next report releases them
+			data.btn = usb_mouse_buttons(pressed[BUTTON_SW1], 0, right, 0, 0) | pulseBtn;
+		}
+		fingerBefore = fingerOnStrip;
+		
+		//Redirect the strip to pan while panning. Pan carries on gliding after the finger stops
+		int16_t panInput = 0;
+		if(rightState == RIGHT_PAN)
+		{
+			panInput = data.scroll;
+			data.scroll = 0;
+		} else if(data.scroll != 0) {
+			//Scrolling stops a glide
+			motionKineticStop(&pan);
+		}
+		data.pan = (int8_t)motionKineticStep(&pan, panInput, INT8_MAX);
+		
+		//Only send a report if something changed, or if the host set an idle period and it has expired
+		uint32_t idleMs = usb_mouse_idle_ms();
+		bool moved = (data.absolute ? (data.x != lastX || data.y != lastY) : (data.x != 0 || data.y != 0));
+		bool changed = (moved || data.scroll != 0 || data.pan != 0 || data.btn != lastBtn);
+		
+		//The report is as old as the oldest motion data or button edge in it. Pan glide and flick pulses aren't timed
+		//A right press held back to rule out a pan carries the time of its edge, so the hold is counted
+		bool touchUsed = (data.scroll != 0 || panInput != 0);
+		if(moved && touchUsed)
+		{
+			data.time = ((int32_t)(touchTime - accelTime) < 0 ? touchTime : accelTime);
+		} else {
+			data.time = (moved ? accelTime : (touchUsed ? touchTime : 0));
+		}
+		if(haveEdge && data.btn != lastBtn && (data.time == 0 || (int32_t)(edgeTime - data.time) < 0))
+		{
+			data.time = edgeTime;
+		}
+		bool idleExpired = (idleMs != 0 && (now - lastReport) >= idleMs/portTICK_RATE_MS);
+		if(changed || idleExpired)
+		{
+			//Wait for send to take the last report, so no button edges are overwritten
+			gatherWait(&received, NOTIFY_SEND_DONE);
+			mouseReport = data;
+			xTaskNotifyGive(sendTaskHandle);
+			lastBtn = data.btn;
+			lastX = data.x;
+			lastY = data.y;
+			lastReport = now;
+			haveEdge = false;
+		}
 		
-		vTaskDelay(10/portTICK_RATE_MS);
+		vTaskDelay(buttonsPeekEvent(&event) ? pendingDelay : paramGet(PARAM_REPORT_MS)/portTICK_RATE_MS);
 	}
 }
 
 void send(void *pvParameters)
 {
 	mouseData_t data;
+	uint8_t lastBtn = 0;
 	while(1)
 	{
-		xQueueReceive(mouseDataQueue, &data, portMAX_DELAY); //Send data to queue, wait forever
-		usb_mouse_send_data(data.x, data.y, data.scroll, 0, data.btn);
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		data = mouseReport;
+		xTaskNotify(gatherTaskHandle, NOTIFY_SEND_DONE, eSetBits);
+		
+		//Lets the USB interrupt measure latency when the host reads the report
+		usb_mouse_set_sample_time(data.time);
+		
+		if(data.absolute)
+		{
+			usb_mouse_send_absolute((uint16_t)data.x, (uint16_t)data.y);
+			//The absolute report has no buttons, wheel or pan, so those go in a relative report with no motion
+			if(data.scroll != 0 || data.pan != 0 || data.btn != lastBtn)
+			{
+				usb_mouse_send_data(0, 0, data.scroll, data.pan, data.btn);
+			}
+		} else if(data.x >= -INT8_MAX && data.x <= INT8_MAX && data.y >= -INT8_MAX && data.y <= INT8_MAX) {
+			usb_mouse_send_data((int8_t)data.x, (int8_t)data.y, data.scroll, data.pan, data.btn);
+		} else {
+			//Too big for the 8-bit report, so use the 16-bit one
+			//That is a separate collection with no buttons, so they go in a relative report with no motion
+			usb_mouse_send_data16(data.x, data.y, data.scroll, data.pan);
+			if(data.btn != lastBtn)
+			{
+				usb_mouse_send_data(0, 0, 0, 0, data.btn);
+			}
+		}
+		lastBtn = data.btn;
 	}
 }
 
@@ -113,50 +416,65 @@ void send(void *pvParameters)
 //Keep a record of distance scrolled since last report
 void touch(void *pvParameters)
 {
-	const uint16_t minTouchThreshold = 150; //This is emperically a good minimum value for the user touching the strip
-	const uint16_t maxTouchThreshold = 1500; //This is emperically a good maximum value for the user touching the strip
-	const uint16_t maxDist = 50; //When we remove our finger, we will get a sharp transition. Ignore this!
+	//Tuning is read from the parameters on every sample, so it can be changed from the console. See param_table.h
+	//touch_min and touch_max: emperically good limits for the user touching the strip
+	//touch_step: when we remove our finger, we will get a sharp transition. Ignore this!
+	//touch_scale: the strip tends to produce values in the range 100-1000. /16 scales this nicely into a full swipe
+	//touch_settle: minimum number of touches before adding to diff. This stops touches being counted as movement
+	uint32_t noTouches =0;
 	
-	//The strip tends to produce values in the range 100-1000. %8 scales this nicely into ~128 for a full swipe. This is the full scale of 
-	const uint8_t scalingFactor = 16;
-	
-	//Minimum number of touches before adding to diff
-	//This stops touches being counted as movement
-	const uint8_t minTouches = 100;
-	uint8_t noTouches =0;
-	
-	const TickType_t delay = 2/portTICK_RATE_MS; //Measure every 2ms
-	
-	struct
-	{
-		bool touched; //True if the button was pressed at the last measurement
-		filterHandle_t filter; //Filter to filter and hold
-	} meas = {false, { {0}, 0, 0}}, prevMeas = {false, { {0}, 0, 0}};
+	//Filter to filter and hold
+	//Only the last output is kept from the previous measurement, rather than a copy of the whole filter
+	filterHandle_t filter = { {0}, 0, 0};
+	filterData_t prevVal = 0;
+	bool touched;
+	bool fingerSeen = false; //Touched at any sample since the last report
 
-	int32_t distance;
+	int32_t distance = 0;
+	
+	//Time of the oldest sample since the last report, for latency measurement
+	uint32_t oldestSample = 0;
+	bool haveSample = false;
 	
 	while(1)
 	{
+		uint32_t sampleMs = paramGet(PARAM_TOUCH_MS);
+		TickType_t delay = sampleMs/portTICK_RATE_MS;
+		
 		//Get measurement
 		uint16_t val = touch_read();
+		uint16_t raw = val;
+		if(!haveSample)
+		{
+			//The moving average delays the strip by half its length, so that is taken off to get the age of what is reported
+			uint32_t filterDelay = ((NO_SAMPLES-1) * sampleMs * (STATS_TIMER_HZ/1000)) / 2;
+			oldestSample = statsTimerRead() - filterDelay;
+			haveSample = true;
+		}
 		
 		//Check if touched
-		meas.touched = (val > minTouchThreshold && val < maxTouchThreshold ? true: false);
+		touched = (val > paramGet(PARAM_TOUCH_MIN) && val < paramGet(PARAM_TOUCH_MAX) ? true: false);
 		
-		if(!meas.touched)
+		uint32_t minTouches = paramGet(PARAM_TOUCH_SETTLE);
+		if(!touched)
 		{
 			val =0;
 			noTouches =0;
 		} else if(noTouches < minTouches) {
 			noTouches++;
 		}
+		fingerSeen = fingerSeen || touched;
 		
 		//Filter values
-		movingAverageAddSample(&meas.filter, val);
+		movingAverageAddSample(&filter, val);
+		
+		int16_t channels[2] = {(int16_t)raw, (int16_t)filter.curVal};
+		telemetrySend(TELEMETRY_TOUCH, channels, 2);
 		
 		if(noTouches >= minTouches)
 		{
-			int32_t diff = ( (int32_t)meas.filter.curVal - (int32_t)prevMeas.filter.curVal);
+			int32_t diff = ( (int32_t)filter.curVal - (int32_t)prevVal);
+			int32_t maxDist = paramGet(PARAM_TOUCH_STEP);
 			//Add up differences
 			if(diff < maxDist && -diff < maxDist )
 			{
@@ -164,15 +482,13 @@ void touch(void *pvParameters)
 			}
 		}
 		
-		prevMeas = meas;
+		prevVal = filter.curVal;
 		
 		//Wait to be asked to report distance.
 		//If we're not asked to, go back around the loop
-		if(xSemaphoreTake(scrollReportSignal, delay))
+		if(ulTaskNotifyTake(pdTRUE, delay))
 		{
-			prevMeas.touched = false;
-			
-			distance = distance/scalingFactor;
+			distance = distance/paramGet(PARAM_TOUCH_SCALE);
 			//Clamp to limits of int8_t
 			if(distance > INT8_MAX)
 			{
@@ -183,34 +499,124 @@ void touch(void *pvParameters)
 				distance = INT8_MIN;
 			}
 			
-			peripheralData_t tx_data = {TOUCH, (int8_t)distance,0};
+			peripheralData_t tx_data = {TOUCH, (int8_t)distance, fingerSeen, 0, oldestSample};
 			distance = 0;
+			fingerSeen = false;
+			haveSample = false;
 			
-			xQueueSend(peripheralReportQueue, &tx_data, portMAX_DELAY);
+			touchReport = tx_data;
+			xTaskNotify(gatherTaskHandle, NOTIFY_TOUCH_REPORT, eSetBits);
 		}
 	}
 }
 
+//Fit a value into a telemetry channel
+static int16_t telemetryClamp(int32_t val)
+{
+	return (val > INT16_MAX) ? INT16_MAX : ((val < INT16_MIN) ? INT16_MIN : (int16_t)val);
+}
+
 void accel(void *pvParameters)
 {
-	const TickType_t delay = 2/portTICK_RATE_MS; //Measure every 2ms
+	//In absolute mode, abs_gain of 16 makes +/-0.5g of tilt (+/-1024 counts) cover the whole screen
+	const int32_t absoluteCentre = (MOUSE_ABSOLUTE_MAX+1)/2;
+	
+	//Tilt is turned into a velocity by the ballistics curve, then integrated over every sample between reports
+	//256 velocity units for 10ms is one count, matching the old per-report scaling of >>8 with the linear curve
+	motionAccumulator_t motionX = {0, 256*10};
+	motionAccumulator_t motionY = {0, 256*10};
+	
+	//Longest gap between samples that will be integrated (e.g. the first sample)
+	const uint32_t maxSampleMs = 20;
+	TickType_t lastSample = xTaskGetTickCount();
+	
+	//Flicks left and right are back and forward
+	gestureHandle_t gestureX;
+	uint8_t gestureBtn = 0;
+	int16_t x,y;
+	readAccel(&x, &y);
+	gestureInit(&gestureX, x);
+	
+	//Time of the newest sample, and the oldest since the last report, for latency measurement
+	uint32_t sampleTime = 0;
+	uint32_t oldestSample = 0;
+	bool haveSample = false;
 	
 	while(1)
 	{
-		int16_t x,y;
+		TickType_t delay = paramGet(PARAM_ACCEL_MS)/portTICK_RATE_MS;
 		
 		readAccel(&x, &y);
+		sampleTime = statsTimerRead();
+		if(!haveSample)
+		{
+			oldestSample = sampleTime;
+			haveSample = true;
+		}
 		
-		//Scale data
-		x >>= 8;
-		y >>= 8; 
+		TickType_t now = xTaskGetTickCount();
+		uint32_t dt = (now - lastSample) * portTICK_RATE_MS;
+		lastSample = now;
+		if(dt > maxSampleMs)
+		{
+			dt = maxSampleMs;
+		}
 		
-		peripheralData_t tx_data = {ACCEL, (int8_t)x, (int8_t)y};
+		if(absoluteMode)
+		{
+			//Motion isn't used, so don't let it build up
+			motionReset(&motionX);
+			motionReset(&motionY);
+		} else {
+			int32_t vx = ballisticsApply(x);
+			int32_t vy = ballisticsApply(y);
+			motionAddSample(&motionX, vx, dt);
+			motionAddSample(&motionY, vy, dt);
+			
+			int16_t channels[4] = {x, y, telemetryClamp(vx), telemetryClamp(vy)};
+			telemetrySend(TELEMETRY_ACCEL, channels, 4);
+			
+			gesture_t gesture = gestureAddSample(&gestureX, x, dt);
+			if(gesture == GESTURE_FLICK_LEFT)
+			{
+				gestureBtn |= MOUSE_BACK;
+			} else if(gesture == GESTURE_FLICK_RIGHT) {
+				gestureBtn |= MOUSE_FORWARD;
+			}
+		}
 		
-		if(xSemaphoreTake(accelReportSignal, delay))
+		if(ulTaskNotifyTake(pdTRUE, delay))
 		{
+			//Absolute mode only reports the newest sample. Relative mode reports all the motion since the last report
+			peripheralData_t tx_data = {ACCEL, 0, 0, 0, (absoluteMode ? sampleTime : oldestSample)};
+			haveSample = false;
+			
+			if(absoluteMode)
+			{
+				//Map tilt straight to a screen position
+				int32_t absoluteGain = paramGet(PARAM_ABS_GAIN);
+				int32_t absX = absoluteCentre + (int32_t)x*absoluteGain;
+				int32_t absY = absoluteCentre + (int32_t)y*absoluteGain;
+				
+				//Clamp to the edges of the screen
+				absX = (absX < 0 ? 0 : (absX > MOUSE_ABSOLUTE_MAX ? MOUSE_ABSOLUTE_MAX : absX));
+				absY = (absY < 0 ? 0 : (absY > MOUSE_ABSOLUTE_MAX ? MOUSE_ABSOLUTE_MAX : absY));
+				
+				tx_data.source = ACCEL_ABSOLUTE;
+				tx_data.payload1 = (int16_t)absX;
+				tx_data.payload2 = (int16_t)absY;
+			} else {
+				//Report the motion since the last report
+				//The remainder, and anything over what fits in a report, is carried over
+				//Large motions go in the 16-bit report, so the limit is that of int16_t
+				tx_data.payload1 = motionTakeCounts(&motionX, INT16_MAX);
+				tx_data.payload2 = motionTakeCounts(&motionY, INT16_MAX);
+				tx_data.btn = gestureBtn;
+				gestureBtn = 0;
+			}
 
-			xQueueSend(peripheralReportQueue, &tx_data, portMAX_DELAY);
+			accelReport = tx_data;
+			xTaskNotify(gatherTaskHandle, NOTIFY_ACCEL_REPORT, eSetBits);
 		}
 	}
 }
@@ -239,15 +645,39 @@ void lcd(void *pvParameters)
 	}
 }
 
-void vApplicationMallocFailedHook( void )
+//Sleep until the next interrupt. SysTick keeps running, so the tick count is exact
+//Idle periods of configEXPECTED_IDLE_TIME_BEFORE_SLEEP ticks or more are handled by vPortSuppressTicksAndSleep
+void vApplicationIdleHook(void)
 {
-	dbg_puts("Malloc failed\r\n");
-	while(1);
+	__DSB();
+	__WFI();
 }
 
+//Fault and assert messages use polled output. They are reported with interrupts masked, so the transmit interrupt would never send them
 
+//Called from the context switch, in PendSV with interrupts masked
 void vApplicationStackOverflowHook( TaskHandle_t xTask, signed char *pcTaskName )
 {
-	dbg_puts("Stack overflow\r\n");
+	uart_puts_polled("Stack overflow in ");
+	uart_puts_polled((const char *)pcTaskName);
+	uart_puts_polled("\r\n");
+	while(1);
+}
+
+void vAssertCalled(const char *pcFile, uint32_t ulLine)
+{
+	uart_puts_polled("Assert failed ");
+	uart_puts_polled(pcFile);
+	uart_puts_polled(":");
+	uart_putdec_polled(ulLine);
+	uart_puts_polled("\r\n");
+	while(1);
+}
+
+//Replaces the endless loop in the startup code
+void HardFault_Handler(void)
+{
+	__disable_irq();
+	uart_puts_polled("Hard fault\r\n");
 	while(1);
 }
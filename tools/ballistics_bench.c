@@ -0,0 +1,177 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Checks the pointer ballistics curves (src/Ballistics/ballistics.c) and times ballisticsApply on the host
+//Checks, for every profile:
+//  The table matches the formula in ballistics.c to within rounding
+//  Every output is within a count of exact linear interpolation between the table entries
+//  Output never falls as tilt rises, and negative tilt gives exactly the negated output
+//The benchmark times small tilts, tilts on the curve and tilts past the end of the table separately
+//They should cost the same, as there are no loops or divides. Host times only compare the cases with each other
+//Evaluating the formula directly, with exp() per sample, is timed too for scale
+//Build and run from the repository root:
+//  cc -std=c99 -Wall -O2 -Isrc/Ballistics/Inc -o ballistics_bench tools/ballistics_bench.c src/Ballistics/ballistics.c -lm
+//  ./ballistics_bench
+//Exits non-zero if any check fails
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include "ballistics.h"
+
+#define TILT_MAX ((BALLISTICS_TABLE_SIZE-1)*BALLISTICS_STEP)
+
+#define BENCH_SAMPLES 20000000L
+
+//The formula from ballistics.c
+static const struct
+{
+	double deadZone;
+	double gain;
+	double knee;
+	double k;
+} shapes[BALLISTICS_NUM_PROFILES] =
+{
+	{0, 1, 1e9, 0}, //LINEAR
+	{96, 0.5, 512, 2}, //SOFT
+	{64, 0.75, 384, 3} //STEEP
+};
+
+static const char * const profileNames[BALLISTICS_NUM_PROFILES] = {"linear", "soft", "steep"};
+
+static int failures = 0;
+
+static double formula(ballisticsProfile_t profile, double m)
+{
+	if(m <= shapes[profile].deadZone)
+	{
+		return 0;
+	}
+	double out = shapes[profile].gain*(m - shapes[profile].deadZone);
+	if(m > shapes[profile].knee)
+	{
+		out *= exp(shapes[profile].k*(m - shapes[profile].knee)/2048);
+	}
+	return out;
+}
+
+static void fail(ballisticsProfile_t profile, const char *what, int32_t tilt, int32_t got, double expected)
+{
+	if(failures++ < 20)
+	{
+		printf("FAIL %s: %s at tilt %ld: %ld, expected %.1f\n", profileNames[profile], what, (long)tilt, (long)got, expected);
+	}
+}
+
+static void checkProfile(ballisticsProfile_t profile)
+{
+	int32_t table[BALLISTICS_TABLE_SIZE];
+
+	ballisticsSetProfile(profile);
+
+	//Entries land exactly on the table, so they can be read back through ballisticsApply
+	for(int i=0; i<BALLISTICS_TABLE_SIZE; i++)
+	{
+		int32_t tilt = i*BALLISTICS_STEP;
+		table[i] = ballisticsApply(tilt);
+		double expected = formula(profile, tilt);
+		if(fabs(table[i] - expected) > 1)
+		{
+			fail(profile, "table entry", tilt, table[i], expected);
+		}
+	}
+
+	int32_t last = 0;
+	for(int32_t tilt=0; tilt<=2*TILT_MAX; tilt++)
+	{
+		int32_t out = ballisticsApply(tilt);
+
+		double expected;
+		if(tilt >= TILT_MAX)
+		{
+			expected = table[BALLISTICS_TABLE_SIZE-1];
+		} else {
+			int i = tilt/BALLISTICS_STEP;
+			expected = table[i] + (table[i+1] - table[i])*(double)(tilt - i*BALLISTICS_STEP)/BALLISTICS_STEP;
+		}
+		if(fabs(out - expected) >= 1)
+		{
+			fail(profile, "interpolation", tilt, out, expected);
+		}
+
+		if(out < last)
+		{
+			fail(profile, "falls", tilt, out, last);
+		}
+		last = out;
+
+		if(ballisticsApply(-tilt) != -out)
+		{
+			fail(profile, "not symmetric", -tilt, ballisticsApply(-tilt), -out);
+		}
+	}
+}
+
+//The same loop with nothing in it, to show how much of each time is the loop
+static double benchLoop(int32_t from, int32_t to)
+{
+	volatile int32_t sink = 0;
+	int32_t span = to - from;
+	clock_t start = clock();
+	for(long n=0; n<BENCH_SAMPLES; n++)
+	{
+		sink += from + (int32_t)((n*7919) % span);
+	}
+	return (double)(clock() - start)/CLOCKS_PER_SEC*1e9/BENCH_SAMPLES;
+}
+
+//Time ballisticsApply over tilts spread across [from, to). Returns ns per sample
+static double benchApply(int32_t from, int32_t to)
+{
+	volatile int32_t sink = 0;
+	int32_t span = to - from;
+	clock_t start = clock();
+	for(long n=0; n<BENCH_SAMPLES; n++)
+	{
+		sink += ballisticsApply(from + (int32_t)((n*7919) % span));
+	}
+	return (double)(clock() - start)/CLOCKS_PER_SEC*1e9/BENCH_SAMPLES;
+}
+
+static double benchFormula(ballisticsProfile_t profile, int32_t from, int32_t to)
+{
+	volatile double sink = 0;
+	int32_t span = to - from;
+	clock_t start = clock();
+	for(long n=0; n<BENCH_SAMPLES; n++)
+	{
+		sink += formula(profile, from + (int32_t)((n*7919) % span));
+	}
+	return (double)(clock() - start)/CLOCKS_PER_SEC*1e9/BENCH_SAMPLES;
+}
+
+int main(void)
+{
+	for(int p=0; p<BALLISTICS_NUM_PROFILES; p++)
+	{
+		checkProfile((ballisticsProfile_t)p);
+	}
+	printf("Checked %d profiles: %d failures\n", BALLISTICS_NUM_PROFILES, failures);
+
+	printf("ns per sample (host), loop included:  loop only %.2f\n", benchLoop(0, TILT_MAX));
+	printf("                        dead zone    curve   past end   formula\n");
+	for(int p=0; p<BALLISTICS_NUM_PROFILES; p++)
+	{
+		ballisticsSetProfile((ballisticsProfile_t)p);
+		printf("  %-20s %9.2f %8.2f %10.2f %9.2f\n", profileNames[p],
+			benchApply(0, 64), benchApply(BALLISTICS_STEP, TILT_MAX), benchApply(TILT_MAX, 2*TILT_MAX),
+			benchFormula((ballisticsProfile_t)p, BALLISTICS_STEP, TILT_MAX));
+	}
+
+	ballisticsSetProfile(BALLISTICS_DEFAULT_PROFILE);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,332 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Simulates clicks on a bouncing switch and measures click to report latency, for the old and new button handling
+//  old: gather reads the pin once a report period (report_ms), and reports the level it sees
+//  new: as src/GPIO/buttons.c and gather. The pin interrupt queues an edge and locks the pin out for BUTTONS_DEBOUNCE_MS
+//       When the lockout timer fires the pin is read again, and another edge queued if it settled the other way
+//       gather takes one edge per button per report, and comes back after MOUSE_INTERVAL while edges are waiting
+//  right: new, for SW2. gather holds a right press back until it is known not to be a pan, as in src/rtos_tasks.c
+//       With the strip left alone, it is sent once held for PAN_DECIDE_MS, or as a whole click when released before then
+//Both are models of the firmware on a 0.1ms timeline with a 1ms tick, not the firmware itself, which needs the hardware
+//Latency is from the contacts first closing or opening to gather handing over a report with the change in it
+//USB polling adds up to MOUSE_INTERVAL to both, and is left out
+//Build and run from the repository root:
+//  cc -std=c99 -Wall -Isrc/GPIO/Inc -Itools/host -o click_latency_sim tools/click_latency_sim.c
+//  ./click_latency_sim [clicks] [seed]
+//Exits non-zero if the new handling loses a click, reports one that didn't happen, or takes more than a report period
+//For SW2 only lost and extra clicks are checked, as the press is held back by design
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include "buttons.h"
+
+//As the defaults in param_table.h and usb_desc.h
+#define REPORT_MS 10
+#define MOUSE_INTERVAL 2
+//As panDecideTime in gather
+#define PAN_DECIDE_MS 300
+
+//Timeline steps per ms. A tick is 1ms
+#define STEPS_PER_MS 10
+
+#define MAX_CLICKS 100000
+#define MAX_BOUNCES 4
+#define MAX_TRANSITIONS (MAX_CLICKS*2*(1 + 2*MAX_BOUNCES))
+//Bounces all happen within this long of the first contact
+#define BOUNCE_STEPS (3*STEPS_PER_MS)
+
+typedef struct
+{
+	long time; //Steps
+	bool pressed;
+} change_t;
+
+static change_t transitions[MAX_TRANSITIONS];
+static int transitionCount = 0;
+
+static long pressTime[MAX_CLICKS];
+static long releaseTime[MAX_CLICKS];
+
+//Reported button changes, for each model
+#define MODELS 3
+static change_t reports[MODELS][MAX_TRANSITIONS];
+static int reportCount[MODELS];
+
+static long randRange(long from, long to)
+{
+	return from + rand() % (to - from + 1);
+}
+
+static int compareChanges(const void *a, const void *b)
+{
+	long ta = ((const change_t *)a)->time, tb = ((const change_t *)b)->time;
+	return (ta > tb) - (ta < tb);
+}
+
+//Contacts meet or part at time, then bounce for a while before settling at level
+static void addTransition(long time, bool level)
+{
+	int bounces = (int)randRange(0, MAX_BOUNCES);
+	change_t *first = &transitions[transitionCount];
+
+	transitions[transitionCount++] = (change_t){time, level};
+	for(int i=0; i<2*bounces; i++)
+	{
+		transitions[transitionCount++] = (change_t){time + randRange(1, BOUNCE_STEPS), level};
+	}
+	//Sort the bounce times, then alternate the level so it ends where it should
+	qsort(first + 1, 2*bounces, sizeof(change_t), compareChanges);
+	for(int i=1; i<=2*bounces; i++)
+	{
+		first[i].pressed = (i & 1) ? !level : level;
+	}
+}
+
+//A mix of quick taps, which the old handling could miss, normal clicks, and holds (drags), which outlast the pan decision
+//Taps are held longer than the bounce, so a press has settled before the release starts
+static long makeClicks(int clicks)
+{
+	long t = 100*STEPS_PER_MS;
+	for(int i=0; i<clicks; i++)
+	{
+		int kind = rand() % 10;
+		long held = (kind < 3) ? randRange(5*STEPS_PER_MS, 15*STEPS_PER_MS) :
+			((kind < 9) ? randRange(40*STEPS_PER_MS, 150*STEPS_PER_MS) : randRange(400*STEPS_PER_MS, 1000*STEPS_PER_MS));
+		pressTime[i] = t;
+		releaseTime[i] = t + held;
+		addTransition(pressTime[i], true);
+		addTransition(releaseTime[i], false);
+		t = releaseTime[i] + BOUNCE_STEPS + randRange(30*STEPS_PER_MS, 400*STEPS_PER_MS);
+	}
+	return t;
+}
+
+static void report(int model, long time, bool pressed)
+{
+	reports[model][reportCount[model]++] = (change_t){time, pressed};
+}
+
+//The pin as gather used to read it
+static void runOld(long end)
+{
+	bool last = false;
+	int next = 0;
+	bool level = false;
+	for(long t=0; t<end; t+=REPORT_MS*STEPS_PER_MS)
+	{
+		while(next < transitionCount && transitions[next].time <= t)
+		{
+			level = transitions[next++].pressed;
+		}
+		if(level != last)
+		{
+			report(0, t, level);
+			last = level;
+		}
+	}
+}
+
+//buttons.c and gather, for one button. For SW2 (right), with the press held back as gather does
+static void runNew(int model, bool right, long end)
+{
+	buttonEvent_t fifo[BUTTONS_FIFO_SIZE];
+	unsigned head = 0, tail = 0;
+	bool state = false; //buttonState
+	bool irqEnabled = true;
+	long timerExpiry = -1;
+	long nextGather = 0;
+	bool reported = false; //pressed[] in gather
+	enum {RIGHT_UP, RIGHT_UNDECIDED, RIGHT_DOWN, RIGHT_CLICK} rightState = RIGHT_UP;
+	long rightStart = 0;
+	bool sent = false; //As last reported to the host
+	int next = 0;
+	bool level = false;
+
+	for(long t=0; t<end; t++)
+	{
+		TickType_t tick = (TickType_t)(t/STEPS_PER_MS);
+
+		//Pin interrupt. Edges while it is off are cleared when it is turned back on, so they are just dropped here
+		bool edge = false;
+		while(next < transitionCount && transitions[next].time <= t)
+		{
+			level = transitions[next++].pressed;
+			edge = true;
+		}
+		if(edge && irqEnabled)
+		{
+			irqEnabled = false;
+			if(level != state && head - tail < BUTTONS_FIFO_SIZE)
+			{
+				fifo[head++ % BUTTONS_FIFO_SIZE] = (buttonEvent_t){tick, 0, level};
+				state = level;
+			}
+			//A timer started on tick n fires on tick n + period
+			timerExpiry = (long)(tick + BUTTONS_DEBOUNCE_MS)*STEPS_PER_MS;
+		}
+
+		//Lockout timer, in the timer task
+		if(t == timerExpiry)
+		{
+			timerExpiry = -1;
+			if(level != state)
+			{
+				if(head - tail < BUTTONS_FIFO_SIZE)
+				{
+					fifo[head++ % BUTTONS_FIFO_SIZE] = (buttonEvent_t){tick, 0, level};
+				}
+				state = level;
+				timerExpiry = (long)(tick + BUTTONS_DEBOUNCE_MS)*STEPS_PER_MS;
+			} else {
+				irqEnabled = true;
+			}
+		}
+
+		//gather, on a tick. Takes at most one edge for the button each report
+		if(t == nextGather)
+		{
+			if(tail != head)
+			{
+				reported = fifo[tail++ % BUTTONS_FIFO_SIZE].pressed;
+			}
+			bool host = reported;
+			if(right)
+			{
+				if(reported)
+				{
+					if(rightState == RIGHT_UP || rightState == RIGHT_CLICK)
+					{
+						rightState = RIGHT_UNDECIDED;
+						rightStart = tick;
+					}
+					if(rightState == RIGHT_UNDECIDED && tick - rightStart >= PAN_DECIDE_MS)
+					{
+						rightState = RIGHT_DOWN;
+					}
+				} else {
+					rightState = (rightState == RIGHT_UNDECIDED ? RIGHT_CLICK : RIGHT_UP);
+				}
+				host = (rightState == RIGHT_DOWN || rightState == RIGHT_CLICK);
+			}
+			if(host != sent)
+			{
+				report(model, t, host);
+				sent = host;
+			}
+			nextGather = (long)(tick + (tail != head ? MOUSE_INTERVAL : REPORT_MS))*STEPS_PER_MS;
+		}
+	}
+}
+
+typedef struct
+{
+	int lost;
+	int extra;
+	long latencySum;
+	long latencyMax;
+	long count;
+	long pressSum;
+	long pressMax;
+} result_t;
+
+//Match each click to the first reported press after it, and its release to the first reported release after that
+static result_t score(int model, int clicks)
+{
+	result_t r = {0, 0, 0, 0, 0, 0, 0};
+	int n = 0;
+	const change_t *rep = reports[model];
+	int presses = 0;
+
+	for(int i=0; i<reportCount[model]; i++)
+	{
+		presses += rep[i].pressed;
+	}
+
+	for(int i=0; i<clicks; i++)
+	{
+		long nextPress = (i+1 < clicks ? pressTime[i+1] : LONG_MAX);
+		while(n < reportCount[model] && rep[n].time < pressTime[i])
+		{
+			n++;
+		}
+		if(n >= reportCount[model] || !rep[n].pressed || rep[n].time >= nextPress)
+		{
+			r.lost++;
+			continue;
+		}
+		long pressLatency = rep[n].time - pressTime[i];
+		n++;
+		if(n >= reportCount[model] || rep[n].pressed || rep[n].time >= nextPress)
+		{
+			r.lost++;
+			continue;
+		}
+		long releaseLatency = rep[n].time - releaseTime[i];
+		n++;
+
+		r.latencySum += pressLatency + releaseLatency;
+		r.count += 2;
+		r.pressSum += pressLatency;
+		if(pressLatency > r.pressMax)
+		{
+			r.pressMax = pressLatency;
+		}
+		if(pressLatency > r.latencyMax)
+		{
+			r.latencyMax = pressLatency;
+		}
+		if(releaseLatency > r.latencyMax)
+		{
+			r.latencyMax = releaseLatency;
+		}
+	}
+	r.extra = presses - (clicks - r.lost);
+	return r;
+}
+
+static void printResult(const char *name, result_t r, int clicks)
+{
+	printf("  %-5s %7d lost (%.1f%%) %5d extra  latency avg %6.2f ms  max %6.2f ms  press avg %6.2f ms  max %6.2f ms\n", name,
+		r.lost, 100.0*r.lost/clicks, r.extra, r.count ? (double)r.latencySum/r.count/STEPS_PER_MS : 0, (double)r.latencyMax/STEPS_PER_MS,
+		r.count ? (double)r.pressSum/(r.count/2)/STEPS_PER_MS : 0, (double)r.pressMax/STEPS_PER_MS);
+}
+
+int main(int argc, char **argv)
+{
+	int clicks = (argc > 1 ? atoi(argv[1]) : 10000);
+	srand(argc > 2 ? (unsigned)strtoul(argv[2], NULL, 0) : 1);
+	if(clicks < 1 || clicks > MAX_CLICKS)
+	{
+		fprintf(stderr, "Clicks must be 1 to %d\n", MAX_CLICKS);
+		return 1;
+	}
+
+	long end = makeClicks(clicks);
+	qsort(transitions, transitionCount, sizeof(change_t), compareChanges);
+	runOld(end);
+	runNew(1, false, end);
+	runNew(2, true, end);
+
+	result_t oldResult = score(0, clicks);
+	result_t newResult = score(1, clicks);
+	result_t rightResult = score(2, clicks);
+	printf("%d clicks, 30%% 5-15ms taps and 10%% 400-1000ms holds, up to %d bounces, report_ms %d, debounce %dms, pan decision %dms\n", clicks, MAX_BOUNCES,
+		REPORT_MS, BUTTONS_DEBOUNCE_MS, PAN_DECIDE_MS);
+	printResult("old", oldResult, clicks);
+	printResult("new", newResult, clicks);
+	printResult("right", rightResult, clicks);
+
+	bool ok = newResult.lost == 0 && newResult.extra == 0 && newResult.latencyMax <= REPORT_MS*STEPS_PER_MS &&
+		rightResult.lost == 0 && rightResult.extra == 0;
+	if(!ok)
+	{
+		printf("FAIL\n");
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,275 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Runs tilt traces through the flick recogniser (src/Gesture/gesture.c) with the default tuning, and counts what it finds
+//Build and run from the repository root:
+//  cc -std=c99 -Wall -Isrc/Gesture/Inc -o gesture_eval tools/gesture_eval.c src/Gesture/gesture.c -lm
+//  ./gesture_eval                   made up movements, some with a flick and some without, each repeated with fresh noise
+//  ./gesture_eval trace.csv ...     recorded traces with no flicks in them, from telemetry_capture.py
+//For recorded traces every flick found is a false positive, and the rate per minute of use is printed
+//For the made up movements, a movement with no flick must give none, and a flick must give one, the right way
+//Exits non-zero if any made up movement without a flick gives one, or fewer than 9 in 10 flicks are found
+//A sweep of flick sizes is printed too, to show where the threshold falls with the noise added
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "gesture.h"
+
+//As the accel task
+#define SAMPLE_MS 2
+
+#define TRIALS 50
+#define NOISE 60
+
+#define PI 3.14159265358979
+
+typedef enum
+{
+	NONE, //No flick. Anything found is a false positive
+	RIGHT, //One flick right
+	LEFT //One flick left
+} expect_t;
+
+typedef struct
+{
+	const char *name;
+	expect_t expect;
+	uint32_t durationMs;
+	double (*shape)(double t); //Tilt away from where the board is held, t in ms
+} movement_t;
+
+static double restShape(double t)
+{
+	(void)t;
+	return 0;
+}
+
+//Out to a steady tilt and back, slowly, as when steering across the screen
+static double steerShape(double t)
+{
+	if(t < 500)
+	{
+		return 900*t/500;
+	} else if(t < 1500) {
+		return 900;
+	} else if(t < 2000) {
+		return 900*(2000 - t)/500;
+	}
+	return 0;
+}
+
+//Out to a steady tilt and back, quickly at each end
+static double heldShape(double t)
+{
+	return (t >= 100 && t < 1100) ? 900 : 0;
+}
+
+static double waveShape(double t)
+{
+	return 1000*sin(2*PI*t/1500);
+}
+
+//Hand tremor
+static double tremorShape(double t)
+{
+	return 400*sin(2*PI*t/125);
+}
+
+//Knocks on the desk: one sample far out every 300ms
+static double knockShape(double t)
+{
+	return ((int)t % 300 == 0) ? 2000 : 0;
+}
+
+//Out and back as a half sine, then a smaller swing the other way as the hand stops it
+static double flick(double t, double amplitude, double outMs)
+{
+	if(t < 100)
+	{
+		return 0;
+	} else if(t < 100 + outMs) {
+		return amplitude*sin(PI*(t - 100)/outMs);
+	} else if(t < 100 + 2*outMs) {
+		return -0.4*amplitude*sin(PI*(t - 100 - outMs)/outMs);
+	}
+	return 0;
+}
+
+static double flickRightShape(double t)
+{
+	return flick(t, 1000, 150);
+}
+
+static double flickLeftShape(double t)
+{
+	return flick(t, -1000, 150);
+}
+
+//For the sensitivity sweep
+static double sweepAmplitude;
+static double sweepShape(double t)
+{
+	return flick(t, sweepAmplitude, 120);
+}
+
+static const movement_t movements[] =
+{
+	{"rest", NONE, 2000, restShape},
+	{"slow steer", NONE, 2500, steerShape},
+	{"held tilt", NONE, 1500, heldShape},
+	{"slow wave", NONE, 3000, waveShape},
+	{"tremor", NONE, 2000, tremorShape},
+	{"desk knocks", NONE, 2000, knockShape},
+	{"flick right", RIGHT, 1000, flickRightShape},
+	{"flick left", LEFT, 1000, flickLeftShape}
+};
+
+//Small repeatable noise, so the results are the same on every host
+static uint32_t noiseState = 1;
+static int noise(int range)
+{
+	noiseState = noiseState*1103515245 + 12345;
+	return (int)((noiseState >> 16) % (2*range+1)) - range;
+}
+
+static int16_t clampTilt(double tilt)
+{
+	return (int16_t)(tilt > INT16_MAX ? INT16_MAX : (tilt < INT16_MIN ? INT16_MIN : tilt));
+}
+
+//Returns the number of trials that gave what was expected
+static int runMovement(const movement_t *m)
+{
+	int left = 0, right = 0, correct = 0;
+
+	for(int trial=0; trial<TRIALS; trial++)
+	{
+		//Held at a different angle each time, which the recogniser should take as the rest position
+		double held = noise(400);
+		gestureHandle_t handle;
+		gestureInit(&handle, clampTilt(held));
+
+		//Settle first, then the movement, then time for the return swing to die away
+		int trialLeft = 0, trialRight = 0;
+		for(uint32_t t=0; t<m->durationMs + 1000; t+=SAMPLE_MS)
+		{
+			double tilt = held + noise(NOISE) + (t >= 500 ? m->shape(t - 500) : 0);
+			gesture_t g = gestureAddSample(&handle, clampTilt(tilt), SAMPLE_MS);
+			trialLeft += (g == GESTURE_FLICK_LEFT);
+			trialRight += (g == GESTURE_FLICK_RIGHT);
+		}
+
+		left += trialLeft;
+		right += trialRight;
+		if((m->expect == NONE && trialLeft + trialRight == 0) ||
+			(m->expect == RIGHT && trialRight == 1 && trialLeft == 0) ||
+			(m->expect == LEFT && trialLeft == 1 && trialRight == 0))
+		{
+			correct++;
+		}
+	}
+
+	printf("  %-12s %-6s %6d %6d %8d/%d", m->name, (m->expect == NONE ? "none" : (m->expect == RIGHT ? "right" : "left")),
+		left, right, correct, TRIALS);
+	return correct;
+}
+
+//CSV from telemetry_capture.py: time in seconds, stream, sequence, then x, y, vx, vy for accel rows
+//The recogniser only looks at x, as in the accel task
+static void runTrace(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	if(!f)
+	{
+		fprintf(stderr, "Can't read %s\n", path);
+		exit(1);
+	}
+
+	gestureHandle_t handle;
+	char line[256];
+	bool started = false;
+	double first = 0, last = 0;
+	long samples = 0;
+	int left = 0, right = 0;
+	while(fgets(line, sizeof(line), f))
+	{
+		double time;
+		char stream[16];
+		int seq, x;
+		if(sscanf(line, "%lf,%15[^,],%d,%d", &time, stream, &seq, &x) != 4 || strcmp(stream, "accel") != 0)
+		{
+			continue;
+		}
+
+		uint32_t dt = SAMPLE_MS;
+		if(!started)
+		{
+			gestureInit(&handle, (int16_t)x);
+			first = time;
+			started = true;
+		} else {
+			dt = (uint32_t)((time - last)*1000 + 0.5);
+		}
+		last = time;
+		samples++;
+
+		gesture_t g = gestureAddSample(&handle, (int16_t)x, dt);
+		if(g != GESTURE_NONE)
+		{
+			printf("  %.3f s: flick %s\n", time - first, g == GESTURE_FLICK_LEFT ? "left" : "right");
+			left += (g == GESTURE_FLICK_LEFT);
+			right += (g == GESTURE_FLICK_RIGHT);
+		}
+	}
+	fclose(f);
+
+	double minutes = (last - first)/60;
+	printf("%s: %ld samples, %.1f s, %d false positives (%d left, %d right)", path, samples, last - first, left + right, left, right);
+	if(minutes > 0)
+	{
+		printf(", %.2f per minute", (left + right)/minutes);
+	}
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	if(argc > 1)
+	{
+		for(int i=1; i<argc; i++)
+		{
+			runTrace(argv[i]);
+		}
+		return 0;
+	}
+
+	bool ok = true;
+	printf("%d trials each, noise +/-%d\n", TRIALS, NOISE);
+	printf("  %-12s %-6s %6s %6s %10s\n", "movement", "flick", "left", "right", "correct");
+	for(unsigned i=0; i<sizeof(movements)/sizeof(movements[0]); i++)
+	{
+		const movement_t *m = &movements[i];
+		int correct = runMovement(m);
+		bool pass = (m->expect == NONE ? correct == TRIALS : correct*10 >= TRIALS*9);
+		printf(" %s\n", pass ? "" : "FAIL");
+		ok = ok && pass;
+	}
+
+	//How far a quick (120ms) flick must go to be found. Not checked, as it depends on the tuning
+	printf("Sensitivity, 120ms flicks:\n");
+	for(int amplitude=600; amplitude<=1000; amplitude+=50)
+	{
+		char name[16];
+		snprintf(name, sizeof(name), "peak %d", amplitude);
+		movement_t m = {name, RIGHT, 1000, sweepShape};
+		sweepAmplitude = amplitude;
+		runMovement(&m);
+		printf("\n");
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,385 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Checks the mouse reports built by src/USB/usb_mouse.c against the report descriptor in src/USB/usb_desc.c
+//The descriptor is read from the source and parsed the way a host does. Each report the firmware builds is then decoded
+//with it, and must give back the values that were sent
+//Also checks that the buttons are only in one top level collection, as each is a separate mouse to Windows
+//Build and run from the repository root:
+//  cc -std=c99 -Wall -Itools/host -Isrc/USB/Inc -o hid_report_test tools/hid_report_test.c src/USB/usb_mouse.c
+//  ./hid_report_test [src/USB/usb_desc.c]
+//Exits non-zero if any check fails
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_dev.h"
+#include "usb_mouse.h"
+
+#define MAX_DESC 512
+#define MAX_FIELDS 32
+#define MAX_USAGES 16
+
+#define PAGE_DESKTOP 0x01
+#define PAGE_BUTTON 0x09
+#define PAGE_CONSUMER 0x0C
+#define USAGE(page, id) (((uint32_t)(page) << 16) | (id))
+
+typedef struct
+{
+	uint8_t reportId;
+	int collection; //Top level collection it is in, counting from 0
+	uint32_t bitOffset; //From the start of the data, after the report ID
+	uint32_t size;
+	uint32_t count;
+	int32_t logMin;
+	int32_t logMax;
+	uint32_t usages[MAX_USAGES]; //One per element. Page in the top 16 bits
+} field_t;
+
+static field_t fields[MAX_FIELDS];
+static int fieldCount = 0;
+static int failures = 0;
+
+//Firmware side: usb_mouse.c builds reports in these and sends them here
+volatile uint8_t usb_configuration = 1;
+static union
+{
+	usb_packet_t packet;
+	uint8_t space[sizeof(usb_packet_t) + MOUSE_SIZE];
+} txSpace;
+static uint8_t sent[MOUSE_SIZE];
+static uint16_t sentLen;
+
+usb_packet_t *usb_malloc(uint32_t endpoint)
+{
+	return &txSpace.packet;
+}
+
+uint32_t usb_tx_packet_count(uint32_t endpoint)
+{
+	return 0;
+}
+
+void usb_tx(uint32_t endpoint, usb_packet_t *packet)
+{
+	if(endpoint != MOUSE_ENDPOINT || packet->len > MOUSE_SIZE)
+	{
+		printf("FAIL: %u byte report on endpoint %u\n", packet->len, (unsigned)endpoint);
+		failures++;
+		return;
+	}
+	memcpy(sent, packet->buf, packet->len);
+	sentLen = packet->len;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+}
+
+//Pull the bytes of mouse_report_desc out of the C source
+static int readDescriptor(const char *path, uint8_t *desc)
+{
+	FILE *f = fopen(path, "r");
+	char line[256];
+	bool inside = false;
+	int len = 0;
+
+	if(!f)
+	{
+		perror(path);
+		exit(2);
+	}
+	while(fgets(line, sizeof(line), f))
+	{
+		if(!inside)
+		{
+			inside = (strstr(line, "mouse_report_desc[] = {") != NULL);
+			continue;
+		}
+		if(strstr(line, "};"))
+		{
+			break;
+		}
+		//Only the bytes before the comment
+		char *comment = strstr(line, "//");
+		if(comment)
+		{
+			*comment = '\0';
+		}
+		for(char *p = strstr(line, "0x"); p; p = strstr(p + 2, "0x"))
+		{
+			if(len == MAX_DESC)
+			{
+				fprintf(stderr, "Descriptor too long\n");
+				exit(2);
+			}
+			desc[len++] = (uint8_t)strtoul(p, NULL, 16);
+		}
+	}
+	fclose(f);
+	if(len == 0)
+	{
+		fprintf(stderr, "mouse_report_desc not found in %s\n", path);
+		exit(2);
+	}
+	return len;
+}
+
+//Parse the descriptor into fields, as in HID 1.11 section 6.2.2
+static void parseDescriptor(const uint8_t *desc, int len)
+{
+	uint32_t usagePage = 0, reportSize = 0, reportCount = 0;
+	int32_t logMin = 0, logMax = 0;
+	uint8_t reportId = 0;
+	uint32_t usages[MAX_USAGES];
+	int usageCount = 0;
+	uint32_t usageMin = 0, usageMax = 0;
+	bool haveRange = false;
+	int depth = 0, collection = -1;
+	uint32_t bitOffset[256] = {0};
+
+	for(int i=0; i<len; )
+	{
+		uint8_t prefix = desc[i++];
+		int size = (prefix & 3) == 3 ? 4 : (prefix & 3);
+		uint8_t type = (prefix >> 2) & 3;
+		uint8_t tag = prefix >> 4;
+		uint32_t data = 0;
+		int32_t sdata;
+
+		for(int b=0; b<size; b++)
+		{
+			data |= (uint32_t)desc[i++] << (8*b);
+		}
+		sdata = (size == 1) ? (int8_t)data : ((size == 2) ? (int16_t)data : (int32_t)data);
+
+		if(type == 1) //Global
+		{
+			switch(tag)
+			{
+				case 0: usagePage = data; break;
+				case 1: logMin = sdata; break;
+				case 2: logMax = sdata; break;
+				case 7: reportSize = data; break;
+				case 8: reportId = (uint8_t)data; break;
+				case 9: reportCount = data; break;
+			}
+		} else if(type == 2) { //Local
+			//A 4 byte usage carries its own page
+			uint32_t usage = (size == 4) ? data : USAGE(usagePage, data);
+			if(tag == 0 && usageCount < MAX_USAGES)
+			{
+				usages[usageCount++] = usage;
+			} else if(tag == 1) {
+				usageMin = usage;
+				haveRange = true;
+			} else if(tag == 2) {
+				usageMax = usage;
+			}
+		} else if(type == 0) { //Main
+			if(tag == 0xA)
+			{
+				if(depth++ == 0)
+				{
+					collection++;
+				}
+			} else if(tag == 0xC) {
+				depth--;
+			} else if(tag == 0x8) {
+				if(fieldCount == MAX_FIELDS || reportCount > MAX_USAGES)
+				{
+					fprintf(stderr, "Descriptor too big to check\n");
+					exit(2);
+				}
+				field_t *field = &fields[fieldCount++];
+				field->reportId = reportId;
+				field->collection = collection;
+				field->bitOffset = bitOffset[reportId];
+				field->size = reportSize;
+				field->count = reportCount;
+				field->logMin = logMin;
+				field->logMax = logMax;
+				for(uint32_t e=0; e<reportCount; e++)
+				{
+					if(haveRange)
+					{
+						uint32_t usage = usageMin + e;
+						field->usages[e] = (usage > usageMax) ? usageMax : usage;
+					} else if(usageCount) {
+						field->usages[e] = usages[(e < (uint32_t)usageCount) ? e : (uint32_t)usageCount-1];
+					} else {
+						field->usages[e] = 0;
+					}
+				}
+				bitOffset[reportId] += reportSize * reportCount;
+			}
+			//Locals only last until the next main item
+			usageCount = 0;
+			haveRange = false;
+		}
+	}
+}
+
+//Bytes in a report, including the ID, from the descriptor
+static uint32_t reportLength(uint8_t reportId)
+{
+	uint32_t bits = 0;
+	for(int i=0; i<fieldCount; i++)
+	{
+		if(fields[i].reportId == reportId)
+		{
+			bits = fields[i].bitOffset + fields[i].size*fields[i].count;
+		}
+	}
+	return 1 + (bits + 7)/8;
+}
+
+//Decode the value of a usage from the last report sent. Returns false if the report doesn't have it
+static bool decode(uint32_t usage, int32_t *value)
+{
+	for(int i=0; i<fieldCount; i++)
+	{
+		field_t *field = &fields[i];
+		if(field->reportId != sent[0])
+		{
+			continue;
+		}
+		for(uint32_t e=0; e<field->count; e++)
+		{
+			if(field->usages[e] != usage)
+			{
+				continue;
+			}
+			uint32_t start = field->bitOffset + e*field->size;
+			uint32_t raw = 0;
+			for(uint32_t b=0; b<field->size; b++)
+			{
+				uint32_t bit = start + b;
+				raw |= (uint32_t)((sent[1 + bit/8] >> (bit%8)) & 1) << b;
+			}
+			int32_t v = (int32_t)raw;
+			if(field->logMin < 0 && (raw & (1u << (field->size-1))))
+			{
+				v = (int32_t)(raw | ~((1u << field->size) - 1));
+			}
+			if(v < field->logMin || v > field->logMax)
+			{
+				printf("FAIL: report %u usage 0x%06x value %ld is outside %ld..%ld\n", sent[0], (unsigned)usage, (long)v, (long)field->logMin, (long)field->logMax);
+				failures++;
+			}
+			*value = v;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void expect(const char *what, uint32_t usage, int32_t want)
+{
+	int32_t got = 0;
+	if(!decode(usage, &got))
+	{
+		printf("FAIL: %s: report %u has no usage 0x%06x\n", what, sent[0], (unsigned)usage);
+		failures++;
+	} else if(got != want) {
+		printf("FAIL: %s: report %u usage 0x%06x decoded as %ld, expected %ld\n", what, sent[0], (unsigned)usage, (long)got, (long)want);
+		failures++;
+	}
+}
+
+static void expectLength(const char *what)
+{
+	if(sentLen != reportLength(sent[0]))
+	{
+		printf("FAIL: %s: report %u is %u bytes, the descriptor says %u\n", what, sent[0], sentLen, (unsigned)reportLength(sent[0]));
+		failures++;
+	}
+}
+
+static void expectButtons(const char *what, uint8_t mask)
+{
+	for(int b=0; b<8; b++)
+	{
+		expect(what, USAGE(PAGE_BUTTON, b+1), (mask >> b) & 1);
+	}
+}
+
+//Buttons must be in exactly one top level collection
+static void checkButtonCollections(void)
+{
+	int buttonCollection = -1;
+	for(int i=0; i<fieldCount; i++)
+	{
+		for(uint32_t e=0; e<fields[i].count; e++)
+		{
+			if((fields[i].usages[e] >> 16) != PAGE_BUTTON)
+			{
+				continue;
+			}
+			if(buttonCollection == -1)
+			{
+				buttonCollection = fields[i].collection;
+			} else if(buttonCollection != fields[i].collection) {
+				printf("FAIL: buttons are in top level collections %d and %d\n", buttonCollection, fields[i].collection);
+				failures++;
+				return;
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint8_t desc[MAX_DESC];
+	int len = readDescriptor(argc > 1 ? argv[1] : "src/USB/usb_desc.c", desc);
+	parseDescriptor(desc, len);
+	printf("%d byte descriptor, %d input fields\n", len, fieldCount);
+
+	checkButtonCollections();
+
+	//8-bit relative report. -128 is sent as -127, as the descriptor's minimum is -127
+	static const int8_t values8[][4] = { {0,0,0,0}, {1,-1,2,-2}, {127,-127,127,-127}, {-128,-128,-128,-128}, {-5,100,0,33} };
+	for(unsigned i=0; i<sizeof(values8)/sizeof(values8[0]); i++)
+	{
+		const int8_t *v = values8[i];
+		uint8_t btn = (uint8_t)(i * 0x35);
+		usb_mouse_send_data(v[0], v[1], v[2], v[3], btn);
+		expectLength("8-bit");
+		expect("8-bit X", USAGE(PAGE_DESKTOP, 0x30), v[0] == -128 ? -127 : v[0]);
+		expect("8-bit Y", USAGE(PAGE_DESKTOP, 0x31), v[1] == -128 ? -127 : v[1]);
+		expect("8-bit wheel", USAGE(PAGE_DESKTOP, 0x38), v[2] == -128 ? -127 : v[2]);
+		expect("8-bit pan", USAGE(PAGE_CONSUMER, 0x238), v[3] == -128 ? -127 : v[3]);
+		expectButtons("8-bit buttons", btn);
+	}
+
+	//16-bit relative report
+	static const int16_t values16[][4] = { {128,-128,0,0}, {32767,-32767,1000,-1000}, {-32768,-32768,-32768,-32768}, {300,-2,129,-129} };
+	for(unsigned i=0; i<sizeof(values16)/sizeof(values16[0]); i++)
+	{
+		const int16_t *v = values16[i];
+		usb_mouse_send_data16(v[0], v[1], v[2], v[3]);
+		expectLength("16-bit");
+		expect("16-bit X", USAGE(PAGE_DESKTOP, 0x30), v[0] == -32768 ? -32767 : v[0]);
+		expect("16-bit Y", USAGE(PAGE_DESKTOP, 0x31), v[1] == -32768 ? -32767 : v[1]);
+		expect("16-bit wheel", USAGE(PAGE_DESKTOP, 0x38), v[2] == -32768 ? -32767 : v[2]);
+		expect("16-bit pan", USAGE(PAGE_CONSUMER, 0x238), v[3] == -32768 ? -32767 : v[3]);
+	}
+
+	//Absolute report. Anything over the maximum is clamped to it
+	static const uint16_t valuesAbs[][2] = { {0,0}, {16384,100}, {MOUSE_ABSOLUTE_MAX,MOUSE_ABSOLUTE_MAX}, {65535,40000} };
+	for(unsigned i=0; i<sizeof(valuesAbs)/sizeof(valuesAbs[0]); i++)
+	{
+		const uint16_t *v = valuesAbs[i];
+		usb_mouse_send_absolute(v[0], v[1]);
+		expectLength("absolute");
+		expect("absolute X", USAGE(PAGE_DESKTOP, 0x30), v[0] > MOUSE_ABSOLUTE_MAX ? MOUSE_ABSOLUTE_MAX : v[0]);
+		expect("absolute Y", USAGE(PAGE_DESKTOP, 0x31), v[1] > MOUSE_ABSOLUTE_MAX ? MOUSE_ABSOLUTE_MAX : v[1]);
+	}
+
+	printf(failures ? "%d checks failed\n" : "All checks passed\n", failures);
+	return failures ? 1 : 0;
+}
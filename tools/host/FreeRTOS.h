@@ -0,0 +1,22 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Stand in for FreeRTOS.h when building firmware modules on the host, for the tools in this directory's parent
+//Only what those modules use is here. Put this directory first on the include path
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef void * TaskHandle_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define portTICK_RATE_MS 1
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define portEND_SWITCHING_ISR(woken) ((void)(woken))
+
+#endif
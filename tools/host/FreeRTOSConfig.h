@@ -0,0 +1,11 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Stand in for FreeRTOSConfig.h on the host. See FreeRTOS.h
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#define configMAX_API_CALL_INTERRUPT_PRIORITY 1
+
+#endif
@@ -0,0 +1,86 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Stand in for src/USB/Inc/kinetis.h, so usb_dev.c and usb_mem.c can run on the host (see tools/usb_queue_model.c)
+//It is in its own directory so it can go ahead of src/USB/Inc on the include path, without the usb_dev.h in the directory above
+//Registers that are only written share a few plain variables
+//The tool provides the variables and functions declared here
+#ifndef KINETIS_H
+#define KINETIS_H
+
+#include <stdint.h>
+
+//Interrupt masking. The tool counts the sections
+void __disable_irq(void);
+void __enable_irq(void);
+
+//Transaction FIFO. TOKDNE reads as set while the tool has a transaction waiting, and reading USB0_STAT takes it
+//On the hardware the FIFO moves on when TOKDNE is cleared, which usb_isr does straight after reading STAT
+//A write to USB0_ISTAT is dropped, as the flags are worked out again on each read
+uint8_t hostUsbStat(void);
+uint8_t *hostUsbIstat(void);
+#define USB0_STAT hostUsbStat()
+#define USB0_ISTAT (*hostUsbIstat())
+
+extern volatile uint8_t hostUsbEndpt[16*4]; //ENDPTn registers are 4 bytes apart
+extern volatile uint8_t hostUsbReg;
+extern volatile uint32_t hostSimReg;
+typedef struct
+{
+	volatile uint32_t SOPT2;
+} hostSim_t;
+extern hostSim_t hostSim;
+typedef struct
+{
+	volatile uint32_t VAL;
+	volatile uint32_t LOAD;
+} hostSysTick_t;
+extern hostSysTick_t hostSysTick;
+
+#define USB0_ENDPT0 hostUsbEndpt[0]
+#define USB0_ENDPT1 hostUsbEndpt[4]
+#define USB0_CTL hostUsbReg
+#define USB0_ADDR hostUsbReg
+#define USB0_ERRSTAT hostUsbReg
+#define USB0_ERREN hostUsbReg
+#define USB0_INTEN hostUsbReg
+#define USB0_BDTPAGE1 hostUsbReg
+#define USB0_BDTPAGE2 hostUsbReg
+#define USB0_BDTPAGE3 hostUsbReg
+#define USB0_OTGISTAT hostUsbReg
+#define USB0_USBCTRL hostUsbReg
+#define USB0_CONTROL hostUsbReg
+#define SIM_SCGC4 hostSimReg
+#define SIM (&hostSim)
+#define SysTick (&hostSysTick)
+
+#define USB_ENDPT_EPSTALL 0x02
+#define USB_ENDPT_EPRXEN 0x08
+#define USB_ENDPT_EPTXEN 0x04
+#define USB_ENDPT_EPHSHK 0x01
+#define USB_CTL_USBENSOFEN 0x01
+#define USB_CTL_ODDRST 0x02
+#define USB_ISTAT_USBRST 0x01
+#define USB_ISTAT_ERROR 0x02
+#define USB_ISTAT_SOFTOK 0x04
+#define USB_ISTAT_TOKDNE 0x08
+#define USB_ISTAT_SLEEP 0x10
+#define USB_ISTAT_STALL 0x80
+#define USB_INTEN_USBRSTEN 0x01
+#define USB_INTEN_ERROREN 0x02
+#define USB_INTEN_SOFTOKEN 0x04
+#define USB_INTEN_TOKDNEEN 0x08
+#define USB_INTEN_SLEEPEN 0x10
+#define USB_INTEN_STALLEN 0x80
+#define USB_CONTROL_DPPULLUPNONOTG 0x10
+#define SIM_SOPT2_USBSRC_MASK 0x40000
+#define SIM_SCGC4_USBOTG 0x40000
+
+#define IRQ_USBOTG 24
+#define NVIC_ENABLE_IRQ(irq) ((void)(irq))
+#define NVIC_DISABLE_IRQ(irq) ((void)(irq))
+#define NVIC_SET_PRIORITY(irq, priority) ((void)(irq), (void)(priority))
+#define NVIC_SystemReset()
+
+#endif
@@ -0,0 +1,20 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Stand in for usb_dev.h on the host, so the report builders in usb_mouse.c can run without the USB stack
+//The tool provides these, and captures the packets sent
+#ifndef _usb_dev_h_
+#define _usb_dev_h_
+
+#include "usb_desc.h"
+#include "usb_mem.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+uint32_t usb_tx_packet_count(uint32_t endpoint);
+void usb_tx(uint32_t endpoint, usb_packet_t *packet);
+
+extern volatile uint8_t usb_configuration;
+
+#endif
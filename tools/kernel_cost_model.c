@@ -0,0 +1,209 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Tick by tick model of the kernel work in the report pipeline (touch, accel, gather, send), for the old queues and semaphores
+//and for the task notifications that replaced them
+//Each kernel call is charged what its path through the FreeRTOS V9 source in src/FreeRTOS does:
+//critical sections entered, scheduler suspensions, and task list operations (inserts and removes), plus report bytes copied
+//The counts come from reading queue.c and tasks.c (see the table below), not from timing, so they hold for any clock
+//Build and run from the repository root:
+//  cc -std=c99 -Wall -Itools/host -Isrc/Inc -o kernel_cost_model tools/kernel_cost_model.c
+//  ./kernel_cost_model [sample_ms] [report_ms]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "rtos_tasks.h"
+
+#define SECONDS 10
+
+typedef enum
+{
+	OLD, //Binary semaphores to ask for reports, queues to return them and to pass them to send
+	NEW, //Task notifications, with reports in shared variables
+	DESIGNS
+} design_t;
+
+typedef enum
+{
+	OP_BLOCK, //A wait that finds nothing and blocks, up to the yield
+	OP_RETURN, //A wait returning with what it was woken for
+	OP_TIMEOUT, //The tick waking a timed out wait, and the wait returning empty handed
+	OP_SIGNAL_WAITER, //A give, send or notify that readies a waiting task
+	OP_SIGNAL, //The same with nobody waiting
+	OP_POLL, //A wait that finds what it wants straight away
+	OP_COUNT
+} op_t;
+
+typedef struct
+{
+	int crit;
+	int suspends;
+	int lists;
+} cost_t;
+
+static const cost_t costs[DESIGNS][OP_COUNT] =
+{
+	{
+		//xQueueGenericReceive: enter/exit, then suspend all, prvLockQueue, xTaskCheckForTimeOut, prvIsQueueEmpty,
+		//vTaskPlaceOnEventList (event list insert, ready list remove, delayed list insert), prvUnlockQueue (two), xTaskResumeAll
+		{7, 1, 3},
+		//Round the loop again, find the item and copy it out
+		{1, 0, 0},
+		//xTaskIncrementTick removes it from the delayed and event lists and readies it (3)
+		//Then round the loop: enter/exit, suspend all, lock, timed out, unlock (two), resume all, prvIsQueueEmpty
+		{7, 1, 3},
+		//xQueueGenericSend: copy in, xTaskRemoveFromEventList (event and state list removes, ready list insert)
+		{1, 0, 3},
+		{1, 0, 0},
+		{1, 0, 0}
+	},
+	{
+		//ulTaskNotifyTake/xTaskNotifyWait: one section, prvAddCurrentTaskToDelayedList (ready list remove, delayed list insert)
+		{1, 0, 2},
+		//The second section, reading and clearing the value
+		{1, 0, 0},
+		//xTaskIncrementTick removes it from the delayed list and readies it, then the second section
+		{1, 0, 2},
+		//xTaskGenericNotify: state list remove, ready list insert
+		{1, 0, 2},
+		{1, 0, 0},
+		//Both sections, without blocking
+		{2, 0, 0}
+	}
+};
+
+typedef struct
+{
+	long calls;
+	long crit;
+	long suspends;
+	long lists;
+	long bytes;
+} total_t;
+
+static total_t totals[DESIGNS];
+
+static void charge(design_t d, op_t op)
+{
+	//Blocks and timeouts are part of the call that blocked, so only count a call where one starts
+	if(op != OP_RETURN && op != OP_TIMEOUT)
+	{
+		totals[d].calls++;
+	}
+	totals[d].crit += costs[d][op].crit;
+	totals[d].suspends += costs[d][op].suspends;
+	totals[d].lists += costs[d][op].lists;
+}
+
+static void copy(design_t d, size_t bytes)
+{
+	totals[d].bytes += (long)bytes;
+}
+
+//One report, from gather asking for the samples to send taking the report
+//touch and accel are a lower priority than gather, and send the same
+static void report(design_t d)
+{
+	const size_t peripheral = sizeof(peripheralData_t);
+	const size_t mouse = sizeof(mouseData_t);
+
+	//gather asks both samplers. They are blocked in their timed waits
+	charge(d, OP_SIGNAL_WAITER);
+	charge(d, OP_SIGNAL_WAITER);
+
+	for(int sampler=0; sampler<2; sampler++)
+	{
+		//gather waits for a report, and the sampler runs
+		charge(d, OP_BLOCK);
+		charge(d, OP_RETURN);
+
+		if(d == OLD)
+		{
+			//xQueueSend into the report queue, then gather copies it out
+			copy(d, peripheral);
+			charge(d, OP_SIGNAL_WAITER);
+			charge(d, OP_RETURN);
+			copy(d, peripheral);
+		} else {
+			//Written to the sampler's report variable, which gather reads in place
+			copy(d, peripheral);
+			charge(d, OP_SIGNAL_WAITER);
+			charge(d, OP_RETURN);
+		}
+
+		//The sampler goes back to its timed wait
+		charge(d, OP_BLOCK);
+	}
+
+	if(d == OLD)
+	{
+		//xQueueSend to send, which is waiting in xQueueReceive, then send copies it out and waits again
+		copy(d, mouse);
+		charge(d, OP_SIGNAL_WAITER);
+		charge(d, OP_RETURN);
+		copy(d, mouse);
+		charge(d, OP_BLOCK);
+	} else {
+		//gather checks send has taken the last report, then hands over this one
+		charge(d, OP_POLL);
+		copy(d, mouse);
+		charge(d, OP_SIGNAL_WAITER);
+		//send copies it, says it is done, and waits again
+		charge(d, OP_RETURN);
+		copy(d, mouse);
+		charge(d, OP_SIGNAL);
+		charge(d, OP_BLOCK);
+	}
+}
+
+//A sampler's timed wait running out, and the next wait starting
+static void sampleTimeout(design_t d)
+{
+	charge(d, OP_TIMEOUT);
+	charge(d, OP_BLOCK);
+}
+
+int main(int argc, char **argv)
+{
+	int sampleMs = (argc > 1 ? atoi(argv[1]) : 2);
+	int reportMs = (argc > 2 ? atoi(argv[2]) : 10);
+	if(sampleMs < 1 || reportMs < 1)
+	{
+		fprintf(stderr, "Usage: %s [sample_ms] [report_ms]\n", argv[0]);
+		return 1;
+	}
+
+	long reports = 0;
+	for(int d=0; d<DESIGNS; d++)
+	{
+		//Tick by tick. Each sampler's wait restarts when gather asks it for a report
+		long nextTimeout = sampleMs;
+		reports = 0;
+		for(long tick=1; tick<=SECONDS*1000; tick++)
+		{
+			if(tick % reportMs == 0)
+			{
+				report((design_t)d);
+				reports++;
+				nextTimeout = tick + sampleMs;
+			} else if(tick == nextTimeout) {
+				sampleTimeout((design_t)d);
+				sampleTimeout((design_t)d);
+				nextTimeout = tick + sampleMs;
+			}
+		}
+	}
+
+	printf("sample_ms %d, report_ms %d, %ld reports in %d s\n", sampleMs, reportMs, reports, SECONDS);
+	printf("Per report, including the samplers' timed waits in between:\n");
+	printf("  %-26s %8s %8s\n", "", "old", "new");
+	printf("  %-26s %8.1f %8.1f\n", "kernel calls", (double)totals[OLD].calls/reports, (double)totals[NEW].calls/reports);
+	printf("  %-26s %8.1f %8.1f\n", "critical sections", (double)totals[OLD].crit/reports, (double)totals[NEW].crit/reports);
+	printf("  %-26s %8.1f %8.1f\n", "scheduler suspensions", (double)totals[OLD].suspends/reports, (double)totals[NEW].suspends/reports);
+	printf("  %-26s %8.1f %8.1f\n", "task list operations", (double)totals[OLD].lists/reports, (double)totals[NEW].lists/reports);
+	printf("  %-26s %8.1f %8.1f\n", "report bytes copied", (double)totals[OLD].bytes/reports, (double)totals[NEW].bytes/reports);
+	return 0;
+}
@@ -0,0 +1,273 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Runs the flash key/value store (src/Flash/kvstore.c) on the host, against a file that stands in for the two flash sectors
+//The simulated flash behaves like NOR flash: erase sets a sector to all 1s, and programming can only clear bits
+//Build from the repository root:
+//  cc -std=c99 -Wall -Isrc/Flash/Inc -o kvstore_sim tools/kvstore_sim.c src/Flash/kvstore.c
+//Use:
+//  kvstore_sim flash.bin set <key> <value>
+//  kvstore_sim flash.bin get <key>
+//  kvstore_sim flash.bin erase
+//  kvstore_sim flash.bin dump
+//  kvstore_sim flash.bin stress <writes> [seed]   random sets with resets (some part way through a write), checked against a model
+//The file is created erased if it doesn't exist
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "flash.h"
+#include "kvstore.h"
+
+#define SIM_SIZE (2*FLASH_SECTOR_SIZE)
+
+static uint8_t flash[SIM_SIZE];
+static uint32_t erases[2];
+
+//Program or erase operations left before a simulated reset. -1 for never
+static long cutAfter = -1;
+static bool cut = false;
+
+static bool simAllowed(void)
+{
+	if(cut)
+	{
+		return false;
+	}
+	if(cutAfter == 0)
+	{
+		cut = true;
+		return false;
+	}
+	if(cutAfter > 0)
+	{
+		cutAfter--;
+	}
+	return true;
+}
+
+static uint32_t simOffset(uint32_t address)
+{
+	if(address < KVSTORE_BASE || address >= KVSTORE_BASE + SIM_SIZE)
+	{
+		fprintf(stderr, "Access outside the store: 0x%lx\n", (unsigned long)address);
+		exit(2);
+	}
+	return address - KVSTORE_BASE;
+}
+
+bool flashEraseSector(uint32_t address)
+{
+	uint32_t offset = simOffset(address);
+	
+	if(offset % FLASH_SECTOR_SIZE)
+	{
+		fprintf(stderr, "Unaligned erase: 0x%lx\n", (unsigned long)address);
+		exit(2);
+	}
+	if(!simAllowed())
+	{
+		//A reset part way through an erase leaves the sector in an unknown state
+		for(uint32_t i=0; i<FLASH_SECTOR_SIZE; i++)
+		{
+			flash[offset + i] &= (uint8_t)rand();
+		}
+		return false;
+	}
+	memset(&flash[offset], 0xFF, FLASH_SECTOR_SIZE);
+	erases[offset / FLASH_SECTOR_SIZE]++;
+	return true;
+}
+
+bool flashProgramWord(uint32_t address, uint32_t data)
+{
+	uint32_t offset = simOffset(address);
+	
+	if(offset % 4)
+	{
+		fprintf(stderr, "Unaligned program: 0x%lx\n", (unsigned long)address);
+		exit(2);
+	}
+	if(!simAllowed())
+	{
+		return false;
+	}
+	for(int i=0; i<4; i++)
+	{
+		uint8_t byte = (uint8_t)(data >> (i*8));
+		if(byte & ~flash[offset + i])
+		{
+			//The FTFA would refuse too, as the word isn't erased
+			fprintf(stderr, "Program over unerased word: 0x%lx\n", (unsigned long)address);
+			exit(2);
+		}
+		flash[offset + i] &= byte;
+	}
+	return true;
+}
+
+uint32_t flashReadWord(uint32_t address)
+{
+	uint32_t offset = simOffset(address);
+	return flash[offset] | (flash[offset+1] << 8) | (flash[offset+2] << 16) | ((uint32_t)flash[offset+3] << 24);
+}
+
+static void simLoad(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	
+	memset(flash, 0xFF, sizeof(flash));
+	if(f)
+	{
+		if(fread(flash, 1, sizeof(flash), f) != sizeof(flash))
+		{
+			fprintf(stderr, "%s is not %d bytes\n", path, SIM_SIZE);
+			exit(2);
+		}
+		fclose(f);
+	}
+}
+
+static void simSave(const char *path)
+{
+	FILE *f = fopen(path, "wb");
+	
+	if(!f || fwrite(flash, 1, sizeof(flash), f) != sizeof(flash))
+	{
+		fprintf(stderr, "Can't write %s\n", path);
+		exit(2);
+	}
+	fclose(f);
+}
+
+//Random sets, with a reset every so often, some of them in the middle of a flash operation
+//After each reset the store must hold, for every key, either the last value set or (if that set was cut short) the one before
+static int simStress(long writes)
+{
+	enum {KEYS = 24};
+	int32_t model[KEYS];
+	bool known[KEYS];
+	int32_t pending = 0;
+	int pendingKey = -1;
+	
+	memset(known, 0, sizeof(known));
+	if(!kvstoreErase())
+	{
+		fprintf(stderr, "Erase failed\n");
+		return 1;
+	}
+	
+	for(long n=0; n<writes; n++)
+	{
+		int key = rand() % KEYS;
+		int32_t value = rand() - RAND_MAX/2;
+		
+		//One write in 50 has a reset somewhere in its next few flash operations
+		if(rand() % 50 == 0)
+		{
+			cutAfter = rand() % 8;
+		}
+		
+		pendingKey = key;
+		pending = value;
+		bool ok = kvstoreSet(key, value);
+		if(ok && !cut)
+		{
+			model[key] = value;
+			known[key] = true;
+			pendingKey = -1;
+		}
+		cutAfter = -1;
+		
+		//Reset after a cut, and sometimes anyway
+		if(cut || rand() % 100 == 0)
+		{
+			cut = false;
+			if(!kvstoreInit())
+			{
+				fprintf(stderr, "Init failed after %ld writes\n", n);
+				return 1;
+			}
+			for(int k=0; k<KEYS; k++)
+			{
+				int32_t stored;
+				bool have = kvstoreGet(k, &stored);
+				if(k == pendingKey && have && stored == pending)
+				{
+					//The cut write made it after all
+					model[k] = pending;
+					known[k] = true;
+				} else if(have != known[k] || (have && stored != model[k])) {
+					fprintf(stderr, "Key %d wrong after %ld writes\n", k, n);
+					return 1;
+				}
+			}
+			pendingKey = -1;
+		}
+	}
+	
+	printf("%ld writes checked. Erases: sector 0 %lu, sector 1 %lu. %lu records free\n",
+		writes, (unsigned long)erases[0], (unsigned long)erases[1], (unsigned long)kvstoreFree());
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if(argc < 3)
+	{
+		fprintf(stderr, "Usage: %s flash.bin set key value | get key | erase | dump | stress writes [seed]\n", argv[0]);
+		return 2;
+	}
+	
+	simLoad(argv[1]);
+	if(!kvstoreInit())
+	{
+		fprintf(stderr, "Init failed\n");
+		return 1;
+	}
+	
+	int result = 0;
+	if(strcmp(argv[2], "set") == 0 && argc == 5)
+	{
+		result = kvstoreSet((uint16_t)strtoul(argv[3], NULL, 0), (int32_t)strtol(argv[4], NULL, 0)) ? 0 : 1;
+	} else if(strcmp(argv[2], "get") == 0 && argc == 4) {
+		int32_t value;
+		if(kvstoreGet((uint16_t)strtoul(argv[3], NULL, 0), &value))
+		{
+			printf("%ld\n", (long)value);
+		} else {
+			printf("not set\n");
+			result = 1;
+		}
+	} else if(strcmp(argv[2], "erase") == 0) {
+		result = kvstoreErase() ? 0 : 1;
+	} else if(strcmp(argv[2], "dump") == 0) {
+		for(uint32_t s=0; s<2; s++)
+		{
+			uint32_t base = KVSTORE_BASE + s*FLASH_SECTOR_SIZE;
+			printf("Sector %lu: magic %08lx generation %08lx\n", (unsigned long)s,
+				(unsigned long)flashReadWord(base), (unsigned long)flashReadWord(base + 4));
+			for(uint32_t a=base+8; a<base+FLASH_SECTOR_SIZE; a+=8)
+			{
+				uint32_t k = flashReadWord(a), v = flashReadWord(a + 4);
+				if(k != 0xFFFFFFFF || v != 0xFFFFFFFF)
+				{
+					printf("  %04lx check %04lx value %ld\n", (unsigned long)(k & 0xFFFF), (unsigned long)(k >> 16), (long)(int32_t)v);
+				}
+			}
+		}
+		printf("%lu records free\n", (unsigned long)kvstoreFree());
+	} else if(strcmp(argv[2], "stress") == 0 && argc >= 4) {
+		srand(argc > 4 ? (unsigned)strtoul(argv[4], NULL, 0) : 1);
+		result = simStress(strtol(argv[3], NULL, 0));
+	} else {
+		fprintf(stderr, "Unknown command\n");
+		return 2;
+	}
+	
+	simSave(argv[1]);
+	return result;
+}
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+#Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+#Licensed under the MIT license
+#See LICENSE.txt
+
+#Turn a raw UART capture from the mouse, with binary log packets mixed into the text, back into text
+#  log_decode.py capture.bin            decode a capture saved as raw bytes
+#  log_decode.py - < /dev/ttyACM0       decode live, once the port is set to the right baud rate (stty)
+#The message table is read from src/Log/Inc/log_messages.h, which must match the firmware that made the capture
+#Packet format is in src/Frame/Inc/frame.h, and the log payload in src/Log/Inc/log.h
+#Telemetry packets are skipped, so this works with the telemetry stream running
+
+import argparse
+import binascii
+import os
+import re
+import struct
+import sys
+
+FRAME_LOG = 3
+FRAME_TELEMETRY = (1, 2)
+FRAME_MAX_PAYLOAD = 40
+#Type, payload, CRC, then COBS adds a byte
+MAX_ENCODED = 1 + FRAME_MAX_PAYLOAD + 2 + 1
+HEADER = 5
+MAX_ARGS = 6
+STATS_TIMER_HZ = 750000
+
+DEFAULT_TABLE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", "Log", "Inc", "log_messages.h")
+
+
+def load_table(path):
+	#One (name, format) per LOG_MESSAGE line, in order, so the index is the ID
+	pattern = re.compile(r'^\s*LOG_MESSAGE\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+	table = []
+	with open(path) as f:
+		for line in f:
+			m = pattern.match(line)
+			if m:
+				table.append((m.group(1), m.group(2).encode().decode("unicode_escape")))
+	return table
+
+
+def format_message(fmt, args):
+	out = []
+	args = list(args)
+	i = 0
+	while i < len(fmt):
+		if fmt[i] == "%" and i+1 < len(fmt) and fmt[i+1] in "udx" and args:
+			val = args.pop(0)
+			if fmt[i+1] == "d" and val >= 0x80000000:
+				val -= 1 << 32
+			out.append(("%x" if fmt[i+1] == "x" else "%d") % val)
+			i += 2
+		else:
+			out.append(fmt[i])
+			i += 1
+	return "".join(out)
+
+
+def cobs_decode(data):
+	out = bytearray()
+	i = 0
+	while i < len(data):
+		code = data[i]
+		if code == 0 or i + code > len(data):
+			return None
+		out += data[i+1:i+code]
+		i += code
+		if code < 0xFF and i < len(data):
+			out.append(0)
+	return bytes(out)
+
+
+def unpack(chunk):
+	#(type, payload) if chunk is a whole packet with a good CRC, otherwise None
+	if len(chunk) > MAX_ENCODED:
+		return None
+	data = cobs_decode(chunk)
+	if data is None or len(data) < 3:
+		return None
+	crc, = struct.unpack_from("<H", data, len(data) - 2)
+	if binascii.crc_hqx(data[:-2], 0xFFFF) != crc:
+		return None
+	return data[0], data[1:-2]
+
+
+def unpack_args(data):
+	#Zigzag varints, 7 bits a byte, low first. None if the last one is cut short or there are too many
+	args = []
+	val = shift = 0
+	for byte in data:
+		val |= (byte & 0x7F) << shift
+		shift += 7
+		if not byte & 0x80:
+			args.append(((val >> 1) ^ -(val & 1)) & 0xFFFFFFFF)
+			val = shift = 0
+	if shift or len(args) > MAX_ARGS:
+		return None
+	return args
+
+
+class Decoder:
+	#Packets have a 0 byte either side, and text never has a 0, so the stream splits into chunks at each 0
+	#A chunk that is a valid packet is decoded, anything else is text
+	def __init__(self, table, out):
+		self.table = table
+		self.out = out
+		self.start = None
+		self.skipped = 0
+
+	def log(self, payload):
+		if len(payload) < HEADER:
+			return False
+		ident, time = struct.unpack_from("<BI", payload)
+		args = unpack_args(payload[HEADER:])
+		if ident >= len(self.table) or args is None:
+			return False
+		if self.start is None:
+			self.start = time
+		self.out.write("[%10.3f ms] %s\n" % (((time - self.start) & 0xFFFFFFFF) * 1000.0 / STATS_TIMER_HZ, format_message(self.table[ident][1], args)))
+		return True
+
+	def chunk(self, chunk):
+		packet = unpack(chunk)
+		if packet is not None and packet[0] == FRAME_LOG and self.log(packet[1]):
+			return
+		if packet is not None and packet[0] in FRAME_TELEMETRY:
+			self.skipped += 1
+			return
+		self.text(chunk)
+
+	def text(self, text):
+		self.out.write(text.decode("ascii", "replace").replace("\r", ""))
+
+
+def decode(stream, table, out):
+	decoder = Decoder(table, out)
+	buf = b""
+	while True:
+		chunk = stream.read(1024)
+		if chunk:
+			buf += chunk
+		pieces = buf.split(b"\0")
+		buf = pieces.pop()
+		for piece in pieces:
+			if piece:
+				decoder.chunk(piece)
+		#Anything longer than a packet with no 0 yet is text, so print it rather than wait
+		if len(buf) > MAX_ENCODED:
+			decoder.text(buf)
+			buf = b""
+		if not chunk:
+			if buf:
+				decoder.chunk(buf)
+			break
+		out.flush()
+	if decoder.skipped:
+		sys.stderr.write("%d telemetry packets skipped\n" % decoder.skipped)
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Decode binary log packets in a mouse UART capture")
+	parser.add_argument("capture", help="raw capture file, or - for stdin")
+	parser.add_argument("-t", "--table", default=DEFAULT_TABLE, help="log_messages.h to take the message table from")
+	args = parser.parse_args()
+
+	table = load_table(args.table)
+	if not table:
+		sys.exit("No LOG_MESSAGE entries in " + args.table)
+
+	if args.capture == "-":
+		decode(sys.stdin.buffer, table, sys.stdout)
+	else:
+		with open(args.capture, "rb") as f:
+			decode(f, table, sys.stdout)
+
+
+if __name__ == "__main__":
+	main()
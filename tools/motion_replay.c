@@ -0,0 +1,248 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Replays accelerometer traces through the motion integrator (src/Motion/motion.c) and compares the pointer path
+//with the old scaling, which sent only the newest sample, shifted right by 8, as an int8_t once per report
+//Both are measured against the exact path: tilt integrated over time, at 1 count per 256 tilt per 10ms report
+//Velocity is taken as the tilt itself (the linear curve), so only the integration is compared, not ballistics
+//Reports are limited to +/-127, as in the 8-bit report, so overflow carried into later reports is covered too
+//Build and run from the repository root:
+//  cc -std=c99 -Wall -Isrc/Motion/Inc -o motion_replay tools/motion_replay.c src/Motion/motion.c -lm
+//  ./motion_replay [trace.csv ...]
+//Traces are CSV files from telemetry_capture.py. Only the accel rows are used
+//With no files, a set of made up traces is replayed instead
+//Exits non-zero if the integrator ends a trace a whole count or more away from the exact path
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "motion.h"
+
+#define MAX_SAMPLES 200000
+
+//As the accel task
+#define SAMPLE_MS 2
+#define REPORT_MS 10
+#define MAX_SAMPLE_MS 20
+#define DIVISOR (256*REPORT_MS)
+
+#define PI 3.14159265358979
+
+typedef struct
+{
+	double time; //ms
+	int16_t tilt[2];
+} sample_t;
+
+static sample_t samples[MAX_SAMPLES];
+
+typedef struct
+{
+	double pos[2];
+	double sumSquares[2];
+	double maxError[2];
+} path_t;
+
+static void pathUpdate(path_t *path, const double *exact)
+{
+	for(int a=0; a<2; a++)
+	{
+		double error = fabs(path->pos[a] - exact[a]);
+		path->sumSquares[a] += error*error;
+		if(error > path->maxError[a])
+		{
+			path->maxError[a] = error;
+		}
+	}
+}
+
+static void pathPrint(const char *name, const path_t *path, const double *exact, long reports)
+{
+	printf("  %-10s end error %7.1f %7.1f  rms %7.2f %7.2f  max %7.1f %7.1f\n", name,
+		path->pos[0] - exact[0], path->pos[1] - exact[1],
+		sqrt(path->sumSquares[0]/reports), sqrt(path->sumSquares[1]/reports),
+		path->maxError[0], path->maxError[1]);
+}
+
+static int16_t oldScale(int16_t tilt)
+{
+	//As the old accel task: x >>= 8, then cast to int8_t. The shift rounds negative tilt down, away from zero
+	return (int8_t)(tilt >> 8);
+}
+
+//Returns false if the integrator ends a count or more off the exact path
+static bool replay(const char *name, int count)
+{
+	motionAccumulator_t motion[2] = { {0, DIVISOR}, {0, DIVISOR} };
+	path_t oldPath, newPath;
+	memset(&oldPath, 0, sizeof(oldPath));
+	memset(&newPath, 0, sizeof(newPath));
+	double exact[2] = {0, 0};
+	long reports = 0;
+
+	if(count == 0)
+	{
+		printf("%s: no accel samples\n", name);
+		return true;
+	}
+
+	double last = samples[0].time - SAMPLE_MS;
+	double nextReport = samples[0].time + REPORT_MS;
+	for(int i=0; i<count; i++)
+	{
+		const sample_t *s = &samples[i];
+		uint32_t dt = (uint32_t)(s->time - last + 0.5);
+		last = s->time;
+		if(dt > MAX_SAMPLE_MS)
+		{
+			dt = MAX_SAMPLE_MS;
+		}
+
+		for(int a=0; a<2; a++)
+		{
+			exact[a] += (double)s->tilt[a]*dt/DIVISOR;
+			motionAddSample(&motion[a], s->tilt[a], dt);
+		}
+
+		if(s->time >= nextReport)
+		{
+			for(int a=0; a<2; a++)
+			{
+				oldPath.pos[a] += oldScale(s->tilt[a]);
+				newPath.pos[a] += motionTakeCounts(&motion[a], INT8_MAX);
+			}
+			pathUpdate(&oldPath, exact);
+			pathUpdate(&newPath, exact);
+			reports++;
+			nextReport += REPORT_MS;
+		}
+	}
+
+	//Let anything held back over the report limit play out
+	for(int n=0; n<1000; n++)
+	{
+		int16_t moved = 0;
+		for(int a=0; a<2; a++)
+		{
+			int16_t counts = motionTakeCounts(&motion[a], INT8_MAX);
+			newPath.pos[a] += counts;
+			moved |= counts;
+		}
+		if(moved == 0)
+		{
+			break;
+		}
+	}
+
+	printf("%s: %d samples, %.1f s, %ld reports, exact path ends at %.1f %.1f counts\n", name, count,
+		(samples[count-1].time - samples[0].time)/1000, reports, exact[0], exact[1]);
+	if(reports == 0)
+	{
+		return true;
+	}
+	pathPrint("old", &oldPath, exact, reports);
+	pathPrint("integrator", &newPath, exact, reports);
+
+	bool ok = fabs(newPath.pos[0] - exact[0]) < 1 && fabs(newPath.pos[1] - exact[1]) < 1;
+	if(!ok)
+	{
+		printf("  FAIL: integrator drifted from the exact path\n");
+	}
+	return ok;
+}
+
+//CSV from telemetry_capture.py: time in seconds, stream, sequence, then x, y, vx, vy for accel rows
+static int readTrace(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	if(!f)
+	{
+		fprintf(stderr, "Can't read %s\n", path);
+		exit(1);
+	}
+
+	char line[256];
+	int count = 0;
+	while(fgets(line, sizeof(line), f) && count < MAX_SAMPLES)
+	{
+		double time;
+		char stream[16];
+		int seq, x, y;
+		if(sscanf(line, "%lf,%15[^,],%d,%d,%d", &time, stream, &seq, &x, &y) == 5 && strcmp(stream, "accel") == 0)
+		{
+			samples[count].time = time*1000;
+			samples[count].tilt[0] = (int16_t)x;
+			samples[count].tilt[1] = (int16_t)y;
+			count++;
+		}
+	}
+	fclose(f);
+	return count;
+}
+
+//Small repeatable noise, so the made up traces are the same on every host
+static int noise(int range)
+{
+	static uint32_t state = 1;
+	state = state*1103515245 + 12345;
+	return (int)((state >> 16) % (2*range+1)) - range;
+}
+
+//Made up traces, 2 seconds each at the accel task's sample rate
+static int makeTrace(int kind)
+{
+	const int count = 2000/SAMPLE_MS;
+	for(int i=0; i<count; i++)
+	{
+		double t = i*SAMPLE_MS;
+		int x = 0, y = 0;
+		switch(kind)
+		{
+			case 0: //Slight tilt each way. The old scaling moved one way only
+				x = 100;
+				y = -100;
+				break;
+			case 1: //Slow circle
+				x = (int)(600*sin(2*PI*t/2000));
+				y = (int)(300*cos(2*PI*t/2000));
+				break;
+			case 2: //Tilted hard for a second, then level
+				x = (t < 1000 ? 3000 : 0);
+				y = (t < 1000 ? -3000 : 0);
+				break;
+			case 3: //Small tilt with sensor noise
+				x = 50 + noise(40);
+				y = -30 + noise(40);
+				break;
+		}
+		samples[i].time = t;
+		samples[i].tilt[0] = (int16_t)x;
+		samples[i].tilt[1] = (int16_t)y;
+	}
+	return count;
+}
+
+int main(int argc, char **argv)
+{
+	static const char * const names[] = {"slight tilt", "slow circle", "hard tilt", "noisy tilt"};
+	bool ok = true;
+
+	if(argc > 1)
+	{
+		for(int i=1; i<argc; i++)
+		{
+			ok = replay(argv[i], readTrace(argv[i])) && ok;
+		}
+	} else {
+		for(int i=0; i<(int)(sizeof(names)/sizeof(names[0])); i++)
+		{
+			ok = replay(names[i], makeTrace(i)) && ok;
+		}
+	}
+
+	return ok ? 0 : 1;
+}
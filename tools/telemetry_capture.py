@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+#Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+#Licensed under the MIT license
+#See LICENSE.txt
+
+#Capture the sensor telemetry stream from the mouse into a CSV trace file
+#  telemetry_capture.py --port /dev/ttyACM0 -o run.csv --raw run.bin    live, needs pyserial. Starts and stops the stream with the telemetry command
+#  telemetry_capture.py --input run.bin -o run.csv                      replay a raw capture through the decoder
+#The CSV has one row per sample: time in seconds, stream, sequence number, then the channels
+#Packet format is in src/Frame/Inc/frame.h, and the telemetry payload in src/Telemetry/Inc/telemetry.h
+#Anything that isn't a telemetry packet (text, log packets) is skipped
+
+import argparse
+import binascii
+import csv
+import struct
+import sys
+
+STATS_TIMER_HZ = 750000
+STREAMS = {1: ("touch", ["raw", "filtered"]), 2: ("accel", ["x", "y", "vx", "vy"])}
+HEADER = 6
+
+
+def cobs_decode(data):
+	out = bytearray()
+	i = 0
+	while i < len(data):
+		code = data[i]
+		if i + code > len(data):
+			return None
+		out += data[i+1:i+code]
+		i += code
+		if code < 0xFF and i < len(data):
+			out.append(0)
+	return bytes(out)
+
+
+class Decoder:
+	def __init__(self, writer):
+		self.writer = writer
+		self.buf = b""
+		self.start = None
+		self.last_time = None
+		self.wraps = 0
+		self.last_seq = None
+		self.packets = 0
+		self.lost = 0
+		self.bad = 0
+
+	def feed(self, data):
+		self.buf += data
+		chunks = self.buf.split(b"\0")
+		self.buf = chunks.pop()
+		for chunk in chunks:
+			if chunk:
+				self.packet(chunk)
+
+	def packet(self, chunk):
+		data = cobs_decode(chunk)
+		if data is None or len(data) < HEADER + 2 or (len(data) - HEADER - 2) % 2:
+			return self.reject()
+		crc, = struct.unpack_from("<H", data, len(data) - 2)
+		if binascii.crc_hqx(data[:-2], 0xFFFF) != crc:
+			return self.reject()
+		kind, seq, time = struct.unpack_from("<BBI", data)
+		if kind not in STREAMS:
+			return self.reject()
+		channels = struct.unpack_from("<%dh" % ((len(data) - HEADER - 2) // 2), data, HEADER)
+
+		#The sequence number is shared by both streams, so a gap is a dropped packet
+		if self.last_seq is not None:
+			self.lost += (seq - self.last_seq - 1) & 0xFF
+		self.last_seq = seq
+		#The stats clock wraps every 95 minutes
+		if self.last_time is not None and time < self.last_time:
+			self.wraps += 1
+		self.last_time = time
+		time += self.wraps << 32
+		if self.start is None:
+			self.start = time
+
+		self.packets += 1
+		self.writer.writerow(["%.6f" % ((time - self.start) / STATS_TIMER_HZ), STREAMS[kind][0], seq] + list(channels))
+
+	def reject(self):
+		#Text and log packets land here too, so this only matters while the stream is running
+		self.bad += 1
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Capture the mouse telemetry stream to CSV")
+	source = parser.add_mutually_exclusive_group(required=True)
+	source.add_argument("--port", help="serial port to capture from (needs pyserial)")
+	source.add_argument("--input", help="raw capture file to decode, or - for stdin")
+	parser.add_argument("--baud", type=int, default=230400)
+	parser.add_argument("--seconds", type=float, default=10, help="how long to capture from --port")
+	parser.add_argument("-o", "--output", required=True, help="CSV trace file to write")
+	parser.add_argument("--raw", help="also save the raw bytes from --port, to replay later with --input")
+	args = parser.parse_args()
+
+	with open(args.output, "w", newline="") as out:
+		writer = csv.writer(out)
+		writer.writerow(["time_s", "stream", "seq", "ch0", "ch1", "ch2", "ch3"])
+		decoder = Decoder(writer)
+
+		if args.port:
+			import serial
+			import time
+			raw = open(args.raw, "wb") if args.raw else None
+			with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+				port.write(b"telemetry on\r")
+				end = time.time() + args.seconds
+				while time.time() < end:
+					data = port.read(4096)
+					if raw:
+						raw.write(data)
+					decoder.feed(data)
+				port.write(b"telemetry off\r")
+			if raw:
+				raw.close()
+		else:
+			f = sys.stdin.buffer if args.input == "-" else open(args.input, "rb")
+			while True:
+				data = f.read(4096)
+				if not data:
+					break
+				decoder.feed(data)
+
+	print("%d packets, %d lost, %d other chunks skipped" % (decoder.packets, decoder.lost, decoder.bad), file=sys.stderr)
+
+
+if __name__ == "__main__":
+	main()
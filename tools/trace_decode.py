@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+#Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+#Licensed under the MIT license
+#See LICENSE.txt
+
+#Turn an event trace dump from the mouse into a timeline
+#Capture the UART output while typing trace at the console (for example with a terminal's log to file option), then:
+#  trace_decode.py capture.txt              prints one event per line
+#  trace_decode.py capture.txt -j out.json  also writes Chrome trace format, for chrome://tracing or ui.perfetto.dev
+#Other lines in the capture (heartbeat, stats) are ignored. If there are several dumps, the last is used
+#The event numbers must match traceEvent_t in src/Trace/Inc/trace.h
+
+import argparse
+import json
+import sys
+
+EVENTS = [
+	"task_in",
+	"task_out",
+	"queue_send",
+	"queue_receive",
+	"queue_send_isr",
+	"queue_receive_isr",
+	"queue_block_send",
+	"queue_block_receive",
+	"notify",
+	"notify_isr",
+	"notify_take",
+	"notify_block",
+	"isr_enter",
+	"isr_exit",
+	"tsi_start",
+	"tsi_end",
+]
+
+#queueQUEUE_TYPE_* in queue.h. Sends and receives on these are gives and takes
+QUEUE_TYPES = ["queue", "mutex", "counting_sem", "binary_sem", "recursive_mutex"]
+
+ISRS = ["USB", "I2C"]
+
+
+def parse(lines):
+	#Returns (clock Hz, events recorded, {task number: name}, [(time, event, id, data)]) for the last complete dump
+	dump = None
+	current = None
+	for line in lines:
+		line = line.strip()
+		#Binary packets (see log_decode.py) have no line ending, so one may be stuck on the front
+		if "TRACE BEGIN" in line:
+			line = line[line.index("TRACE BEGIN"):]
+			fields = line.split()
+			current = (int(fields[2]), int(fields[3]), {}, [])
+		elif current is None:
+			continue
+		elif line == "TRACE END":
+			dump = current
+			current = None
+		elif line.startswith("TOO MANY TASKS"):
+			print("Warning: " + line.lower() + ", so tasks are shown by number", file=sys.stderr)
+		elif line.startswith("TASK "):
+			fields = line.split(None, 2)
+			current[2][int(fields[1])] = fields[2] if len(fields) > 2 else ""
+		elif len(line) == 16:
+			try:
+				current[3].append((int(line[0:8], 16), int(line[8:10], 16), int(line[10:12], 16), int(line[12:16], 16)))
+			except ValueError:
+				pass
+	if dump is None:
+		sys.exit("No complete trace dump found")
+	return dump
+
+
+def unwrap(records):
+	#The stats clock is 32 bits, so allow for it wrapping during the trace
+	out = []
+	offset = 0
+	last = None
+	for time, event, ident, data in records:
+		if last is not None and time < last:
+			offset += 1 << 32
+		last = time
+		out.append((time + offset, event, ident, data))
+	return out
+
+
+def describe(event, ident, data, tasks):
+	name = EVENTS[event] if event < len(EVENTS) else "event%d" % event
+	if event in (0, 1, 11):
+		return name, tasks.get(ident, "task%d" % ident)
+	if 2 <= event <= 7:
+		kind = QUEUE_TYPES[data] if data < len(QUEUE_TYPES) else "type%d" % data
+		return name, "%s %d" % (kind, ident)
+	if event in (8, 9, 10):
+		return name, "%s value=%d" % (tasks.get(ident, "task%d" % ident), data)
+	if event in (12, 13):
+		return name, ISRS[ident] if ident < len(ISRS) else "isr%d" % ident
+	if event == 15:
+		return name, "count=%d" % data
+	return name, ""
+
+
+def chrome(hz, tasks, records):
+	#Tasks and interrupts become duration slices on their own rows, everything else an instant on the row it happened in
+	us = lambda t: (t - records[0][0]) * 1e6 / hz
+	out = []
+	running = None
+	for time, event, ident, data in records:
+		name, detail = describe(event, ident, data, tasks)
+		if event == 0:
+			running = tasks.get(ident, "task%d" % ident)
+			out.append({"name": running, "ph": "B", "ts": us(time), "pid": 0, "tid": "tasks"})
+		elif event == 1:
+			out.append({"name": tasks.get(ident, "task%d" % ident), "ph": "E", "ts": us(time), "pid": 0, "tid": "tasks"})
+			running = None
+		elif event in (12, 13):
+			out.append({"name": detail, "ph": "B" if event == 12 else "E", "ts": us(time), "pid": 0, "tid": "isr " + detail})
+		elif event in (14, 15):
+			out.append({"name": "TSI", "ph": "B" if event == 14 else "E", "ts": us(time), "pid": 0, "tid": "tsi", "args": {"count": data} if event == 15 else {}})
+		else:
+			out.append({"name": name, "ph": "i", "s": "t", "ts": us(time), "pid": 0, "tid": "tasks", "args": {"detail": detail, "task": running}})
+	#A slice open at the end of the dump can't be closed, and would confuse the viewer, so drop everything before the first switch in
+	first = next((i for i, e in enumerate(out) if e["ph"] == "B" and e["tid"] == "tasks"), len(out))
+	return {"traceEvents": out[first:], "displayTimeUnit": "ms"}
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Decode a mouse event trace dump")
+	parser.add_argument("capture", help="UART capture containing a TRACE BEGIN ... TRACE END dump")
+	parser.add_argument("-j", "--json", help="also write Chrome trace format JSON to this file")
+	args = parser.parse_args()
+
+	with open(args.capture, errors="replace") as f:
+		hz, recorded, tasks, records = parse(f)
+	if not records:
+		sys.exit("Trace dump is empty")
+	records = unwrap(records)
+
+	if recorded > len(records):
+		print("# %d older events were overwritten" % (recorded - len(records)))
+	start = records[0][0]
+	for time, event, ident, data in records:
+		name, detail = describe(event, ident, data, tasks)
+		print("%12.1f us  %-20s %s" % ((time - start) * 1e6 / hz, name, detail))
+
+	if args.json:
+		with open(args.json, "w") as f:
+			json.dump(chrome(hz, tasks, records), f)
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,292 @@
+//Copyright (c) 2016 Steven Yan and Joshua Lewis Tyler
+//Licensed under the MIT license
+//See LICENSE.txt
+
+//Runs the mouse endpoint's transmit queue from src/USB/usb_dev.c on the host: usb_tx, the TOKDNE transmit path in usb_isr,
+//SET_CONFIGURATION in usb_setup, and the packet and byte counters, with the pool from src/USB/usb_mem.c sized by usb_desc.h
+//usb_dev.c is included here, so its queue and buffer descriptor table can be looked at. tools/host/usb/kinetis.h stands in
+//for the registers, and this plays the host, taking each descriptor the USB module owns in even/odd turn, at varying rates
+//Checked after every step:
+//  usb_tx_packet_count and usb_tx_byte_count match a walk of the queue, done as the old functions did it
+//  Every packet sent reaches the host once and in order, and a descriptor the USB module owns is never overwritten
+//  No packet goes missing from the pool
+//It is run twice: sending as usb_mouse.c does, only while fewer than TX_PACKET_LIMIT (1) packets are queued, and ignoring
+//the count, so the queue is as deep as the pool lets it get
+//Interrupt masked sections entered by the count queries are counted. The time the old walk kept interrupts masked is an
+//estimate, from the most packets it would have visited and the instructions in its loop (loads 2, taken branches 2, others 1)
+//Build and run from the repository root:
+//  cc -std=c99 -Wall -Wno-unknown-pragmas -Wno-attributes -Wno-pointer-to-int-cast -Itools/host/usb -Isrc/USB/Inc -Itools/host
+//    -Isrc/Stats/Inc -Isrc/Trace/Inc -o usb_queue_model tools/usb_queue_model.c src/USB/usb_mem.c
+//  ./usb_queue_model [steps] [seed]
+//Exits non-zero if any check fails
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../src/USB/usb_dev.c"
+
+//As usb_mouse.c
+#define TX_PACKET_LIMIT 1
+
+//Estimated cycles for the old walk with interrupts masked
+#define CYCLES_MASK 2 //cpsid and cpsie
+#define CYCLES_BYTES_NODE 8 //ldrh len, adds, ldr next, cmp, bne
+
+//Provided for usb_dev.c, which takes them from usb_desc.c and usb_mouse.c. Only the endpoint configuration is used here
+const uint8_t usb_endpoint_config_table[NUM_ENDPOINTS] = {ENDPOINT1_CONFIG};
+const usb_descriptor_list_t usb_descriptor_list[] = {{0, 0, NULL, 0}};
+void usb_init_serialnumber(void) {}
+volatile uint8_t usb_mouse_idle_rate = 0;
+
+//Registers for kinetis.h
+volatile uint8_t hostUsbEndpt[16*4];
+volatile uint8_t hostUsbReg;
+volatile uint32_t hostSimReg;
+hostSim_t hostSim;
+hostSysTick_t hostSysTick;
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) { (void)clearOnExit; (void)ticksToWait; return 0; }
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) { (void)task; (void)woken; }
+uint32_t statsIsrEnter(void) { return 0; }
+void statsIsrExit(statsIsr_t isr, uint32_t start) { (void)isr; (void)start; }
+uint32_t statsTimerRead(void) { return 0; }
+void statsLatencyRecord(uint32_t counts) { (void)counts; }
+void traceRecord(uint8_t event, uint8_t id, uint16_t data) { (void)event; (void)id; (void)data; }
+
+//Interrupt masking, for kinetis.h
+static int masked = 0;
+static long maskedSections = 0;
+
+void __disable_irq(void)
+{
+	masked++;
+	maskedSections++;
+}
+
+void __enable_irq(void)
+{
+	masked--;
+}
+
+//Transactions the host has finished, waiting for usb_isr. The hardware FIFO holds 4
+#define STAT_FIFO_SIZE 4
+static uint8_t statFifo[STAT_FIFO_SIZE];
+static int statCount = 0;
+static uint8_t istat;
+
+uint8_t hostUsbStat(void)
+{
+	uint8_t stat = statFifo[0];
+	statCount--;
+	memmove(statFifo, statFifo + 1, statCount);
+	return stat;
+}
+
+uint8_t *hostUsbIstat(void)
+{
+	istat = (statCount > 0 ? USB_ISTAT_TOKDNE : 0);
+	return &istat;
+}
+
+static int failures = 0;
+
+static void fail(long step, const char *what)
+{
+	if(failures++ < 20)
+	{
+		printf("FAIL at step %ld: %s\n", step, what);
+	}
+}
+
+//Sequence numbers, in the first 4 bytes of each packet
+static uint32_t nextSeq;
+static uint32_t expectSeq;
+static long sent;
+static long received;
+
+//As the old usb_queue_byte_count, counting the packets it visits
+static uint32_t oldByteCount(const usb_packet_t *p, int *nodes)
+{
+	uint32_t count = 0;
+	*nodes = 0;
+	for( ; p; p = p->next)
+	{
+		count += p->len;
+		(*nodes)++;
+	}
+	return count;
+}
+
+//The host reads the next descriptor if the USB module has given it one
+static int hostOdd = 0;
+static bool hostRead(long step)
+{
+	bdt_t *b = &table[index(MOUSE_ENDPOINT, TX, hostOdd)];
+	if(!(b->desc & BDT_OWN))
+	{
+		return false;
+	}
+
+	uint32_t seq;
+	memcpy(&seq, b->addr, sizeof(seq));
+	if(seq != expectSeq)
+	{
+		fail(step, "host got a packet out of order");
+	}
+	expectSeq = seq + 1;
+	received++;
+
+	//The USB module gives the descriptor back, and queues the transaction
+	b->desc &= ~BDT_OWN;
+	statFifo[statCount++] = (MOUSE_ENDPOINT << 4) | 0x08 | (hostOdd << 2);
+	hostOdd ^= 1;
+	usb_isr();
+	return true;
+}
+
+static uint32_t queueCount(void)
+{
+	uint32_t count = 0;
+	for(const usb_packet_t *p = tx_first[MOUSE_ENDPOINT-1]; p; p = p->next)
+	{
+		count++;
+	}
+	return count;
+}
+
+static int ownedCount(void)
+{
+	return ((table[index(MOUSE_ENDPOINT, TX, EVEN)].desc & BDT_OWN) != 0) + ((table[index(MOUSE_ENDPOINT, TX, ODD)].desc & BDT_OWN) != 0);
+}
+
+static void configure(void)
+{
+	setup.wRequestAndType = 0x0900;
+	setup.wValue = 1;
+	usb_setup();
+	//Anything in flight was thrown away
+	expectSeq = nextSeq;
+	received = sent;
+	//usb_setup starts the endpoint again on whichever buffer was free. The hardware would still be waiting on the other one
+	//if it held a packet, but a host doesn't configure the device while reading from it, so start the host where usb_dev.c will
+	hostOdd = (tx_state[MOUSE_ENDPOINT-1] == TX_STATE_BOTH_FREE_ODD_FIRST);
+}
+
+typedef struct
+{
+	int deepest;
+	long queries;
+	long queryMasks;
+} result_t;
+
+static result_t run(long steps, uint32_t limit)
+{
+	result_t r = {0, 0, 0};
+	int hostRate = 1;
+
+	configure();
+	for(long n=0; n<steps; n++)
+	{
+		//The host polls in slow and fast spells, so the queue fills up and empties again
+		if(n % 5000 == 0)
+		{
+			hostRate = 1 + rand() % 8;
+		}
+		if(n % 200000 == 199999)
+		{
+			configure();
+		}
+
+		int action = rand() % 10;
+		if(action < 4)
+		{
+			//The send task, as usb_mouse_get_packet
+			long before = maskedSections;
+			uint32_t queued = usb_tx_packet_count(MOUSE_ENDPOINT);
+			r.queryMasks += maskedSections - before;
+			r.queries++;
+
+			usb_packet_t *packet = (queued < limit ? usb_malloc(MOUSE_ENDPOINT) : NULL);
+			if(!packet)
+			{
+				if(queued < limit && queueCount() + ownedCount() < MOUSE_BUFFERS)
+				{
+					fail(n, "pool empty with packets unaccounted for");
+				}
+			} else {
+				static const uint16_t lens[] = {5, 6, 9};
+				memcpy(packet->buf, &nextSeq, sizeof(nextSeq));
+				packet->len = lens[rand() % 3];
+
+				bdt_t before[2] = {table[index(MOUSE_ENDPOINT, TX, EVEN)], table[index(MOUSE_ENDPOINT, TX, ODD)]};
+				usb_tx(MOUSE_ENDPOINT, packet);
+				for(int odd=0; odd<2; odd++)
+				{
+					const bdt_t *b = &table[index(MOUSE_ENDPOINT, TX, odd)];
+					if((before[odd].desc & BDT_OWN) && (b->addr != before[odd].addr || b->desc != before[odd].desc))
+					{
+						fail(n, "usb_tx overwrote a descriptor the USB module owns");
+					}
+				}
+				nextSeq++;
+				sent++;
+			}
+		} else if(action < 4 + hostRate/2) {
+			hostRead(n);
+		}
+
+		int nodes;
+		uint32_t bytes = oldByteCount(tx_first[MOUSE_ENDPOINT-1], &nodes);
+		if((uint32_t)nodes != usb_tx_packet_count(MOUSE_ENDPOINT) || bytes != usb_tx_byte_count(MOUSE_ENDPOINT))
+		{
+			fail(n, "counters don't match the queue");
+		}
+		if(nodes > r.deepest)
+		{
+			r.deepest = nodes;
+		}
+		if(sent - received != nodes + ownedCount())
+		{
+			fail(n, "packets sent but neither queued, owned by the USB module, nor received");
+		}
+		if(masked != 0)
+		{
+			fail(n, "interrupts left masked");
+		}
+	}
+
+	//Let the host take the rest
+	while(hostRead(steps));
+	if(expectSeq != nextSeq || tx_first[MOUSE_ENDPOINT-1] || usb_tx_packet_count(MOUSE_ENDPOINT) || usb_tx_byte_count(MOUSE_ENDPOINT))
+	{
+		fail(steps, "queue not drained at the end");
+	}
+	return r;
+}
+
+static void printResult(const char *name, result_t r)
+{
+	uint32_t oldCycles = CYCLES_MASK + r.deepest*CYCLES_BYTES_NODE;
+	printf("  %-26s %7d %13.3f %10lu (%4.2f us)\n", name, r.deepest, (double)r.queryMasks/r.queries,
+		(unsigned long)oldCycles, oldCycles/48.0);
+}
+
+int main(int argc, char **argv)
+{
+	long steps = (argc > 1 ? strtol(argv[1], NULL, 0) : 1000000);
+	srand(argc > 2 ? (unsigned)strtoul(argv[2], NULL, 0) : 1);
+
+	usb_configuration = 1;
+	result_t limited = run(steps, TX_PACKET_LIMIT);
+	result_t unlimited = run(steps, UINT32_MAX);
+
+	printf("%ld steps each, endpoint %d pool of %d packets of %d bytes, %d of them can be in the descriptors\n",
+		steps, MOUSE_ENDPOINT, MOUSE_BUFFERS, MOUSE_SIZE, 2);
+	printf("  %-26s %7s %13s %22s\n", "", "deepest", "masks/query", "old walk, estimated");
+	printResult("limit 1, as usb_mouse.c", limited);
+	printResult("no limit", unlimited);
+	printf("%d failures\n", failures);
+	return failures ? 1 : 0;
+}